@@ -2,12 +2,16 @@
 
 
 #include "Enemy.h"
+#include "HomingTargetSubsystem.h"
+#include "SonicEnemyPopulationSubsystem.h"
+#include "SonicSignificanceSubsystem.h"
+#include "SonicTickManagerSubsystem.h"
 
 // Sets default values
 AEnemy::AEnemy()
 {
- 	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Per-frame work goes through BatchTick. Blueprint subclasses that implement Event Tick still get a tick.
+	PrimaryActorTick.bCanEverTick = false;
 
 	Capsule = CreateDefaultSubobject<UCapsuleComponent>(TEXT("Capsule"));
 	Capsule->SetupAttachment(RootComponent);
@@ -20,14 +24,68 @@ AEnemy::AEnemy()
 void AEnemy::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	if (bCanBeDormant)
+	{
+		if (USonicEnemyPopulationSubsystem* Population = GetWorld()->GetSubsystem<USonicEnemyPopulationSubsystem>())
+		{
+			Population->AddEnemy(this);
+
+			// Went dormant straight away
+			if (IsActorBeingDestroyed())
+			{
+				return;
+			}
+		}
+	}
+
+	if (UHomingTargetSubsystem* HomingSubsystem = GetWorld()->GetSubsystem<UHomingTargetSubsystem>())
+	{
+		HomingSubsystem->RegisterTarget(this);
+	}
+
+	if (USonicTickManagerSubsystem* TickManager = GetWorld()->GetSubsystem<USonicTickManagerSubsystem>())
+	{
+		TickManager->RegisterActor(this);
+	}
+
+	if (USonicSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<USonicSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterActor(this);
+	}
 }
 
-// Called every frame
-void AEnemy::Tick(float DeltaTime)
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (UHomingTargetSubsystem* HomingSubsystem = GetWorld()->GetSubsystem<UHomingTargetSubsystem>())
+	{
+		HomingSubsystem->UnregisterTarget(this);
+	}
+
+	if (USonicTickManagerSubsystem* TickManager = GetWorld()->GetSubsystem<USonicTickManagerSubsystem>())
+	{
+		TickManager->UnregisterActor(this);
+	}
 
+	if (USonicSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<USonicSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterActor(this);
+	}
+
+	if (PopulationIndex != INDEX_NONE)
+	{
+		if (USonicEnemyPopulationSubsystem* Population = GetWorld()->GetSubsystem<USonicEnemyPopulationSubsystem>())
+		{
+			Population->OnEnemyEndPlay(this, EndPlayReason);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AEnemy::BatchTick(float DeltaTime, float InDistanceToPlayer)
+{
+	DistanceToPlayer = InDistanceToPlayer;
 }
 
 // Called to bind functionality to input
@@ -5,10 +5,11 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
 #include "Components/CapsuleComponent.h"
+#include "SonicBatchTickable.h"
 #include "Enemy.generated.h"
 
 UCLASS()
-class SONICGAME_API AEnemy : public APawn
+class SONICGAME_API AEnemy : public APawn, public ISonicBatchTickable
 {
 	GENERATED_BODY()
 
@@ -20,9 +21,10 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void BatchTick(float DeltaTime, float InDistanceToPlayer) override;
 
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
@@ -34,4 +36,21 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UCapsuleComponent* Capsule;
+
+	/** Updated every frame by the tick manager, for Blueprint logic that reacts to the player getting close. */
+	UPROPERTY(BlueprintReadOnly)
+	float DistanceToPlayer = TNumericLimits<float>::Max();
+
+	/**
+	 * Lets the enemy be kept as a dormant entry instead of an actor while the player is far away, see USonicEnemyPopulationSubsystem.
+	 * It is respawned from its class when the player comes back, so leave this off for enemies with per-instance settings.
+	 */
+	UPROPERTY(Category = "Population", EditAnywhere, BlueprintReadOnly)
+	bool bCanBeDormant = false;
+
+private:
+	friend class USonicEnemyPopulationSubsystem;
+
+	/** Entry of this enemy in the population subsystem, or INDEX_NONE if it has none. */
+	int32 PopulationIndex = INDEX_NONE;
 };
@@ -2,12 +2,19 @@
 
 
 #include "GrindRail.h"
+#include "SonicGame.h"
+#include "GrindRailSubsystem.h"
+#include "RailBakeData.h"
+#include "Algo/BinarySearch.h"
+
+/** Radius of the sphere the side rail table moves out to each side, like the sweeps the player used to run. */
+static constexpr float SideRailSearchRadius = 40.0f;
 
 // Sets default values
 AGrindRail::AGrindRail()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Rails have no per-frame work. Blueprint subclasses that implement Event Tick still get a tick.
+	PrimaryActorTick.bCanEverTick = false;
 
 	RailSpline = CreateDefaultSubobject<USplineComponent>(TEXT("RailSpline"));
 	RailSpline->SetupAttachment(RootComponent);
@@ -18,12 +25,300 @@ void AGrindRail::BeginPlay()
 {
 	Super::BeginPlay();
 	
+	if (RailTable.IsStale(RailSpline))
+	{
+		if (!BuildRailTableFromBake())
+		{
+			RailTable.Build(RailSpline, RailSampleSpacing);
+		}
+	}
+
+	if (UGrindRailSubsystem* RailSubsystem = GetWorld()->GetSubsystem<UGrindRailSubsystem>())
+	{
+		RailSubsystem->RegisterRail(this);
+	}
+}
+
+void AGrindRail::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UGrindRailSubsystem* RailSubsystem = GetWorld()->GetSubsystem<UGrindRailSubsystem>())
+	{
+		RailSubsystem->UnregisterRail(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGrindRail::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	BakeRailTable();
+}
+
+void AGrindRail::BakeRailTable()
+{
+	RailTable.Build(RailSpline, RailSampleSpacing);
+	bUsingRailBake = false;
+
+	// Keep the world rail index in sync with the new samples
+	if (HasActorBegunPlay())
+	{
+		if (UGrindRailSubsystem* RailSubsystem = GetWorld()->GetSubsystem<UGrindRailSubsystem>())
+		{
+			RailSubsystem->RegisterRail(this);
+		}
+	}
+}
+
+bool AGrindRail::BuildRailTableFromBake()
+{
+	bUsingRailBake = false;
+
+	if (!RailBakeData || !RailSpline)
+	{
+		return false;
+	}
+
+	if (!RailBakeData->IsBakeValidFor(RailBakeIndex, RailSpline, RailSampleSpacing))
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("%s: the rail bake is out of date, sampling the spline instead. Bake the level's rails again."), *GetName());
+		return false;
+	}
+
+	TArray<FVector> Samples;
+	float MaxError = 0.0f;
+	RailBakeData->DecodeLocations(RailBakeIndex, RailSpline->GetComponentTransform(), Samples, MaxError);
+
+	const FBakedRail& BakedRail = RailBakeData->GetBakedRail(RailBakeIndex);
+	RailTable.BuildFromSamples(RailSpline, MoveTemp(Samples), BakedRail.SampleSpacing, BakedRail.RailLength, MaxError);
+
+	bUsingRailBake = RailTable.IsBuilt();
+	return bUsingRailBake;
+}
+
+#if WITH_EDITOR
+void AGrindRail::BakeRailsInLevel()
+{
+	if (GetWorld() && GetWorld()->IsGameWorld())
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Rails can only be baked outside of play."));
+		return;
+	}
+
+	URailBakeData::BakeLevel(GetLevel());
+}
+
+void AGrindRail::SetRailBake(URailBakeData* BakeData, int32 Index)
+{
+	Modify();
+	RailBakeData = BakeData;
+	RailBakeIndex = Index;
+}
+#endif
+
+float AGrindRail::GetClosestDistanceToLocation(const FVector& Location, float* OutDistanceSq) const
+{
+	if (!RailSpline)
+	{
+		return -1.0f;
+	}
+
+	if (!RailTable.IsStale(RailSpline))
+	{
+		return RailTable.FindClosestDistance(Location, OutDistanceSq);
+	}
+
+	// The spline was edited after the table was baked, ask the spline directly until it is rebaked
+	INC_DWORD_STAT_BY(STAT_SonicSplineEvaluations, OutDistanceSq ? 3 : 2);
+	const float InputKey = RailSpline->FindInputKeyClosestToWorldLocation(Location);
+	if (OutDistanceSq)
+	{
+		*OutDistanceSq = FVector::DistSquared(Location, RailSpline->GetLocationAtSplineInputKey(InputKey, ESplineCoordinateSpace::World));
+	}
+
+	return RailSpline->GetDistanceAlongSplineAtSplineInputKey(InputKey);
+}
+
+FRailFrame AGrindRail::GetRailFrameAtDistance(float Distance) const
+{
+	FRailFrame Frame;
+	if (!RailSpline)
+	{
+		return Frame;
+	}
+
+	INC_DWORD_STAT(STAT_SonicSplineEvaluations);
+
+	const FSplineCurves& Curves = RailSpline->SplineCurves;
+	const FTransform& SplineTransform = RailSpline->GetComponentTransform();
+	const float InputKey = GetInputKeyAtDistance(Distance);
+
+	// Same maths as USplineComponent::GetQuaternionAtSplineInputKey, but the tangent is only evaluated once
+	const FVector LocalTangent = Curves.Position.EvalDerivative(InputKey, FVector::ZeroVector);
+	FQuat LocalRotation = Curves.Rotation.Eval(InputKey, FQuat::Identity);
+	LocalRotation.Normalize();
+	const FVector LocalUp = LocalRotation.RotateVector(RailSpline->DefaultUpVector);
+	const FQuat LocalFrame = FRotationMatrix::MakeFromXZ(LocalTangent.GetSafeNormal(), LocalUp).ToQuat();
+
+	Frame.Location = SplineTransform.TransformPosition(Curves.Position.Eval(InputKey, FVector::ZeroVector));
+	Frame.Tangent = SplineTransform.TransformVector(LocalTangent);
+	Frame.Rotation = SplineTransform.GetRotation() * LocalFrame;
+	Frame.Up = Frame.Rotation.GetUpVector();
+	Frame.Right = Frame.Rotation.GetRightVector();
+	Frame.Roll = Frame.Rotation.Rotator().Roll;
+
+	return Frame;
+}
+
+float AGrindRail::GetInputKeyAtDistance(float Distance) const
+{
+	const TArray<FInterpCurvePoint<float>>& Points = RailSpline->SplineCurves.ReparamTable.Points;
+	const int32 NumPoints = Points.Num();
+	if (NumPoints == 0)
+	{
+		return 0.0f;
+	}
+
+	if (NumPoints == 1 || Distance <= Points[0].InVal)
+	{
+		return Points[0].OutVal;
+	}
+
+	if (Distance >= Points.Last().InVal)
+	{
+		return Points.Last().OutVal;
+	}
+
+	auto IsInSegment = [&Points, Distance](int32 Segment)
+	{
+		return Distance >= Points[Segment].InVal && Distance < Points[Segment + 1].InVal;
+	};
+
+	// Grinding only moves a few units a frame, so try the last segment and its neighbours before searching
+	int32 Segment = FMath::Clamp(LastFrameSegment, 0, NumPoints - 2);
+	if (!IsInSegment(Segment))
+	{
+		if (Segment + 1 <= NumPoints - 2 && IsInSegment(Segment + 1))
+		{
+			Segment++;
+		}
+		else if (Segment > 0 && IsInSegment(Segment - 1))
+		{
+			Segment--;
+		}
+		else
+		{
+			Segment = FMath::Clamp(Algo::UpperBoundBy(Points, Distance, &FInterpCurvePoint<float>::InVal) - 1, 0, NumPoints - 2);
+		}
+	}
+
+	LastFrameSegment = Segment;
+
+	// The reparameterization table is linear between its points
+	const FInterpCurvePoint<float>& Start = Points[Segment];
+	const FInterpCurvePoint<float>& End = Points[Segment + 1];
+	const float SegmentLength = End.InVal - Start.InVal;
+	const float Alpha = SegmentLength > KINDA_SMALL_NUMBER ? (Distance - Start.InVal) / SegmentLength : 0.0f;
+
+	return FMath::Lerp(Start.OutVal, End.OutVal, Alpha);
+}
+
+FRailFrame AGrindRail::GetApproxRailFrameAtDistance(float Distance) const
+{
+	if (bUsingRailBake && RailBakeData && !RailTable.IsStale(RailSpline))
+	{
+		return RailBakeData->GetFrameAtDistance(RailBakeIndex, Distance, RailSpline->GetComponentTransform());
+	}
+
+	return GetRailFrameAtDistance(Distance);
 }
 
-// Called every frame
-void AGrindRail::Tick(float DeltaTime)
+void AGrindRail::BuildSideRailTable()
 {
-	Super::Tick(DeltaTime);
+	SideRailTable.Reset();
+
+	UGrindRailSubsystem* RailSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UGrindRailSubsystem>() : nullptr;
+	if (!RailSubsystem || !RailSpline)
+	{
+		return;
+	}
+
+	bSideRailTableStale = false;
+
+	// Same shape as the sweeps the player used to run every frame: a sphere moved out to the side of the rail
+	auto FindNeighbor = [this, RailSubsystem](const FVector& Location, const FVector& Direction, const FVector& SideVector, FRailSideNeighbor& OutNeighbor)
+	{
+		const FVector SearchStart = Location + SideVector * SideRailSearchOffset;
+		const FVector SearchEnd = SearchStart + SideVector * SideRailSearchDistance;
+
+		FGrindRailQueryResult SideHit;
+		if (RailSubsystem->FindFirstRailAlongSegment(SearchStart, SearchEnd, SideRailSearchRadius, SideHit, this))
+		{
+			const FVector SideDirection = SideHit.Rail->GetApproxRailFrameAtDistance(SideHit.Distance).Tangent;
+
+			OutNeighbor.Rail = SideHit.Rail;
+			OutNeighbor.Distance = SideHit.Distance;
+			OutNeighbor.Direction = FVector::DotProduct(Direction, SideDirection) >= 0.0f ? 1.0f : -1.0f;
+		}
+	};
+
+	const float RailLength = RailSpline->GetSplineLength();
+	const int32 NumIntervals = FMath::Max(FMath::CeilToInt(RailLength / SideRailIntervalLength), 1);
+	SideRailTable.SetNum(NumIntervals);
+
+	for (int32 i = 0; i < NumIntervals; i++)
+	{
+		const float Distance = FMath::Min((i + 0.5f) * SideRailIntervalLength, RailLength);
+		const FRailFrame Frame = GetApproxRailFrameAtDistance(Distance);
+
+		FindNeighbor(Frame.Location, Frame.Tangent, Frame.Right, SideRailTable[i].Right);
+		FindNeighbor(Frame.Location, Frame.Tangent, -Frame.Right, SideRailTable[i].Left);
+	}
+}
+
+float AGrindRail::GetSideRailSearchReach() const
+{
+	return SideRailSearchOffset + SideRailSearchDistance + SideRailSearchRadius;
+}
+
+AGrindRail* AGrindRail::FindSideRail(float Distance, bool bRightSide, float& OutTargetDistance)
+{
+	UGrindRailSubsystem* RailSubsystem = GetWorld()->GetSubsystem<UGrindRailSubsystem>();
+	if (!RailSubsystem)
+	{
+		return nullptr;
+	}
+
+	// Rails were added or removed nearby since the table was built
+	if (bSideRailTableStale)
+	{
+		BuildSideRailTable();
+	}
+
+	if (SideRailTable.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	const int32 Index = FMath::Clamp(FMath::FloorToInt(Distance / SideRailIntervalLength), 0, SideRailTable.Num() - 1);
+	const FRailSideNeighbor& Neighbor = bRightSide ? SideRailTable[Index].Right : SideRailTable[Index].Left;
+
+	AGrindRail* SideRail = Neighbor.Rail.Get();
+	if (!SideRail || !SideRail->GetActorEnableCollision())
+	{
+		return nullptr;
+	}
+
+	// Carry how far into the interval we are over to the side rail
+	const float IntervalMiddle = FMath::Min((Index + 0.5f) * SideRailIntervalLength, RailSpline->GetSplineLength());
+	const float TargetDistance = Neighbor.Distance + (Distance - IntervalMiddle) * Neighbor.Direction;
+	const float SideRailLength = SideRail->RailSpline->GetSplineLength();
 
+	// Fmod keeps the sign of its input, wrap twice so any distance on a loop lands in [0, Length)
+	OutTargetDistance = SideRail->RailSpline->IsClosedLoop() && SideRailLength > 0.0f
+		? FMath::Fmod(FMath::Fmod(TargetDistance, SideRailLength) + SideRailLength, SideRailLength)
+		: FMath::Clamp(TargetDistance, 0.0f, SideRailLength);
+	return SideRail;
 }
 
@@ -5,8 +5,50 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/SplineComponent.h"
+#include "RailArcLengthTable.h"
 #include "GrindRail.generated.h"
 
+class AGrindRail;
+class URailBakeData;
+
+/** A rail running beside another one, and where on it a rail switch lands. */
+struct FRailSideNeighbor
+{
+	TWeakObjectPtr<AGrindRail> Rail;
+
+	/** Distance on Rail level with the middle of the interval. */
+	float Distance = 0.0f;
+
+	/** 1 if Rail runs the same way as the source rail, -1 if it runs the opposite way. */
+	float Direction = 1.0f;
+};
+
+/** Left and right neighbours of one arc-length interval of a rail. */
+struct FRailSideInterval
+{
+	FRailSideNeighbor Left;
+
+	FRailSideNeighbor Right;
+};
+
+/** Everything about a point on a rail, in world space. */
+struct FRailFrame
+{
+	FVector Location = FVector::ZeroVector;
+
+	/** Spline tangent, not normalized. Its length is the speed of the spline at this point. */
+	FVector Tangent = FVector::ForwardVector;
+
+	FVector Up = FVector::UpVector;
+
+	FVector Right = FVector::RightVector;
+
+	FQuat Rotation = FQuat::Identity;
+
+	/** Roll of Rotation in degrees. */
+	float Roll = 0.0f;
+};
+
 UCLASS()
 class SONICGAME_API AGrindRail : public AActor
 {
@@ -25,13 +67,71 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent)
 	void RailJump();
 
+	/** Rebuilds the arc-length lookup table from the current state of RailSpline. */
+	UFUNCTION(BlueprintCallable, Category = "Rail Grinding")
+	void BakeRailTable();
+
+	/**
+	 * Finds the distance along the rail closest to a world location.
+	 * Uses the baked arc-length table, or the spline itself if the table is out of date.
+	 * @param Location			World location to project onto the rail
+	 * @param OutDistanceSq	Squared distance between Location and the closest point on the rail
+	 */
+	float GetClosestDistanceToLocation(const FVector& Location, float* OutDistanceSq = nullptr) const;
+
+	/**
+	 * Evaluates location, tangent, up, right and roll at a distance along the rail in one go.
+	 * Same results as the separate USplineComponent getters, but the distance to input key lookup is
+	 * done once and starts from the segment used by the previous call, which is nearly always the right one
+	 * while grinding. Game thread only.
+	 */
+	FRailFrame GetRailFrameAtDistance(float Distance) const;
+
+	/**
+	 * Rail frame at a distance along the rail read from the rail's bake if it has a valid one, which costs no spline evaluation.
+	 * Otherwise the same as GetRailFrameAtDistance. Good enough for building lookup tables, not for moving along the rail.
+	 */
+	FRailFrame GetApproxRailFrameAtDistance(float Distance) const;
+
+	FORCEINLINE const FRailArcLengthTable& GetRailTable() const { return RailTable; }
+
+	/** Rebuilds the table of rails to the left and right of this one from the world rail index. */
+	void BuildSideRailTable();
+
+	/** Makes FindSideRail rebuild the side rail table first. Called by the rail index when a rail within reach comes or goes. */
+	void MarkSideRailTableStale() { bSideRailTableStale = true; }
+
+	bool IsSideRailTableStale() const { return bSideRailTableStale; }
+
+	/** How far out from the rail the side rail table looks for other rails. */
+	float GetSideRailSearchReach() const;
+
+	/**
+	 * Looks up the rail beside this one at a distance along it.
+	 * Left and right are relative to the direction of the spline.
+	 * @param Distance				Distance along this rail
+	 * @param bRightSide			Look for the rail on the right instead of the left
+	 * @param OutTargetDistance	Landing distance on the side rail
+	 * @return The side rail, or null if there is none
+	 */
+	AGrindRail* FindSideRail(float Distance, bool bRightSide, float& OutTargetDistance);
+
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+#if WITH_EDITOR
+	/** Bakes every loaded rail in this rail's level into the level's rail bake asset. Save the rails and the asset afterwards. */
+	UFUNCTION(CallInEditor, Category = "Rail Grinding")
+	void BakeRailsInLevel();
+
+	/** Points the rail at baked rail Index of BakeData. */
+	void SetRailBake(URailBakeData* BakeData, int32 Index);
+#endif
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	UPROPERTY(BlueprintReadWrite)
@@ -39,4 +139,56 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float MinRailSpeed = 500.0f;
+
+	/** Spacing of the baked arc-length samples. Smaller is more accurate but uses more memory. */
+	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "1.0"))
+	float RailSampleSpacing = 25.0f;
+
+	/** Radius of the rail around its spline, used when detecting the player landing on it. */
+	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadOnly)
+	float RailCollisionRadius = 10.0f;
+
+	/** Length of the stretch of rail covered by one entry of the side rail table. */
+	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "1.0"))
+	float SideRailIntervalLength = 100.0f;
+
+	/** Side rails are searched for from this far beside the rail... */
+	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadOnly)
+	float SideRailSearchOffset = 60.0f;
+
+	/** ...out to this much further. */
+	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadOnly)
+	float SideRailSearchDistance = 300.0f;
+
+	/**
+	 * Quantized samples of this rail baked by the RailBake commandlet or Bake Rails In Level, loaded with the level.
+	 * Used instead of sampling the spline at BeginPlay, unless the spline has changed since it was baked.
+	 */
+	UPROPERTY(Category = "Rail Grinding", VisibleAnywhere)
+	TObjectPtr<URailBakeData> RailBakeData;
+
+private:
+	/** Builds RailTable from RailBakeData. False if there is no bake or it no longer matches the spline. */
+	bool BuildRailTableFromBake();
+
+	/** Spline input key at Distance, reading the spline's reparameterization table from the cached segment. */
+	float GetInputKeyAtDistance(float Distance) const;
+
+private:
+	FRailArcLengthTable RailTable;
+
+	/** Entry of RailBakeData holding this rail. */
+	UPROPERTY()
+	int32 RailBakeIndex = INDEX_NONE;
+
+	/** True while RailTable was built from RailBakeData and the spline hasn't been rebaked since. */
+	bool bUsingRailBake = false;
+
+	/** Reparameterization table segment the last rail frame was found in. */
+	mutable int32 LastFrameSegment = 0;
+
+	TArray<FRailSideInterval> SideRailTable;
+
+	/** True until SideRailTable is built, and again whenever a rail within reach of it is added or removed. */
+	bool bSideRailTableStale = true;
 };
@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GrindRailSubsystem.h"
+#include "GrindRail.h"
+#include "TimerManager.h"
+
+void UGrindRailSubsystem::RegisterRail(AGrindRail* Rail)
+{
+	if (!Rail)
+	{
+		return;
+	}
+
+	UnregisterRail(Rail);
+
+	const FRailArcLengthTable& RailTable = Rail->GetRailTable();
+	if (!RailTable.IsBuilt())
+	{
+		return;
+	}
+
+	FRegisteredRail& Registered = RegisteredRails.Add(Rail);
+	TArray<FIntVector>& RailCells = Registered.Cells;
+	const TArray<FVector>& Samples = RailTable.GetSamples();
+
+	for (int32 Segment = 0; Segment < Samples.Num() - 1; Segment++)
+	{
+		FBox SegmentBounds(ForceInit);
+		SegmentBounds += Samples[Segment];
+		SegmentBounds += Samples[Segment + 1];
+		SegmentBounds = SegmentBounds.ExpandBy(Rail->RailCollisionRadius);
+		Registered.Bounds += SegmentBounds;
+
+		const FIntVector MinCell = GetCell(SegmentBounds.Min);
+		const FIntVector MaxCell = GetCell(SegmentBounds.Max);
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+				{
+					const FIntVector Cell(X, Y, Z);
+					Cells.FindOrAdd(Cell).Add({ Rail, Segment });
+					RailCells.AddUnique(Cell);
+				}
+			}
+		}
+	}
+
+	Rails.Add(Rail);
+	RailSetVersion++;
+
+	MaxSideRailSearchReach = FMath::Max(MaxSideRailSearchReach, Rail->GetSideRailSearchReach());
+
+	// The new rail needs a table of its own, and may be beside rails that already have one
+	Rail->MarkSideRailTableStale();
+	PendingSideRailTables.Add(Rail);
+	MarkNearbySideRailTablesStale(Rail, Registered.Cells, Registered.Bounds);
+}
+
+void UGrindRailSubsystem::UnregisterRail(AGrindRail* Rail)
+{
+	if (!RegisteredRails.Contains(Rail))
+	{
+		return;
+	}
+
+	FRegisteredRail Registered;
+	RegisteredRails.RemoveAndCopyValue(Rail, Registered);
+	PendingSideRailTables.Remove(Rail);
+
+	for (const FIntVector& Cell : Registered.Cells)
+	{
+		if (TArray<FRailSegmentRef>* Segments = Cells.Find(Cell))
+		{
+			Segments->RemoveAllSwap([Rail](const FRailSegmentRef& Ref) { return Ref.Rail == Rail; });
+			if (Segments->Num() == 0)
+			{
+				Cells.Remove(Cell);
+			}
+		}
+	}
+
+	Rails.RemoveSwap(Rail);
+	RailSetVersion++;
+
+	MarkNearbySideRailTablesStale(Rail, Registered.Cells, Registered.Bounds);
+}
+
+bool UGrindRailSubsystem::FindClosestRail(const FVector& Location, float Radius, FGrindRailQueryResult& OutResult, const AGrindRail* IgnoreRail) const
+{
+	const FIntVector MinCell = GetCell(Location - FVector(Radius));
+	const FIntVector MaxCell = GetCell(Location + FVector(Radius));
+
+	float BestDistanceSq = TNumericLimits<float>::Max();
+	const FRailSegmentRef* BestRef = nullptr;
+	FVector BestLocation = FVector::ZeroVector;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				const TArray<FRailSegmentRef>* Segments = Cells.Find(FIntVector(X, Y, Z));
+				if (!Segments)
+				{
+					continue;
+				}
+
+				for (const FRailSegmentRef& Ref : *Segments)
+				{
+					// Rails turn their collision off for a moment after being exited, don't reattach to them
+					if (Ref.Rail == IgnoreRail || !Ref.Rail->GetActorEnableCollision())
+					{
+						continue;
+					}
+
+					const TArray<FVector>& Samples = Ref.Rail->GetRailTable().GetSamples();
+					const FVector ClosestPoint = FMath::ClosestPointOnSegment(Location, Samples[Ref.Segment], Samples[Ref.Segment + 1]);
+					const float DistanceSq = FVector::DistSquared(ClosestPoint, Location);
+					const float ReachSq = FMath::Square(Radius + Ref.Rail->RailCollisionRadius);
+
+					if (DistanceSq <= ReachSq && DistanceSq < BestDistanceSq)
+					{
+						BestDistanceSq = DistanceSq;
+						BestRef = &Ref;
+						BestLocation = ClosestPoint;
+					}
+				}
+			}
+		}
+	}
+
+	if (!BestRef)
+	{
+		return false;
+	}
+
+	OutResult.Rail = BestRef->Rail;
+	OutResult.Location = BestLocation;
+	OutResult.Distance = BestRef->Rail->GetRailTable().GetDistanceAtSegmentPoint(BestRef->Segment, BestLocation);
+	OutResult.DistanceSq = BestDistanceSq;
+	return true;
+}
+
+bool UGrindRailSubsystem::FindFirstRailAlongSegment(const FVector& Start, const FVector& End, float Radius, FGrindRailQueryResult& OutResult, const AGrindRail* IgnoreRail) const
+{
+	FBox SearchBounds(ForceInit);
+	SearchBounds += Start;
+	SearchBounds += End;
+	SearchBounds = SearchBounds.ExpandBy(Radius);
+
+	const FIntVector MinCell = GetCell(SearchBounds.Min);
+	const FIntVector MaxCell = GetCell(SearchBounds.Max);
+
+	float BestTravelSq = TNumericLimits<float>::Max();
+	const FRailSegmentRef* BestRef = nullptr;
+	FVector BestLocation = FVector::ZeroVector;
+	float BestDistanceSq = 0.0f;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				const TArray<FRailSegmentRef>* Segments = Cells.Find(FIntVector(X, Y, Z));
+				if (!Segments)
+				{
+					continue;
+				}
+
+				for (const FRailSegmentRef& Ref : *Segments)
+				{
+					if (Ref.Rail == IgnoreRail)
+					{
+						continue;
+					}
+
+					const TArray<FVector>& Samples = Ref.Rail->GetRailTable().GetSamples();
+
+					FVector PointOnSearch;
+					FVector PointOnRail;
+					FMath::SegmentDistToSegmentSafe(Start, End, Samples[Ref.Segment], Samples[Ref.Segment + 1], PointOnSearch, PointOnRail);
+
+					const float DistanceSq = FVector::DistSquared(PointOnSearch, PointOnRail);
+					const float TravelSq = FVector::DistSquared(Start, PointOnSearch);
+
+					// Keep the rail reached first along the search, like a sweep would
+					if (DistanceSq <= FMath::Square(Radius + Ref.Rail->RailCollisionRadius) && TravelSq < BestTravelSq)
+					{
+						BestTravelSq = TravelSq;
+						BestRef = &Ref;
+						BestLocation = PointOnRail;
+						BestDistanceSq = DistanceSq;
+					}
+				}
+			}
+		}
+	}
+
+	if (!BestRef)
+	{
+		return false;
+	}
+
+	OutResult.Rail = BestRef->Rail;
+	OutResult.Location = BestLocation;
+	OutResult.Distance = BestRef->Rail->GetRailTable().GetDistanceAtSegmentPoint(BestRef->Segment, BestLocation);
+	OutResult.DistanceSq = BestDistanceSq;
+	return true;
+}
+
+void UGrindRailSubsystem::MarkNearbySideRailTablesStale(const AGrindRail* ChangedRail, const TArray<FIntVector>& RailCells, const FBox& Bounds)
+{
+	// Only rails in the cells around the changed one can reach it
+	const int32 CellReach = FMath::CeilToInt32(MaxSideRailSearchReach / CellSize);
+	TSet<FIntVector> VisitedCells;
+
+	for (const FIntVector& RailCell : RailCells)
+	{
+		for (int32 X = RailCell.X - CellReach; X <= RailCell.X + CellReach; X++)
+		{
+			for (int32 Y = RailCell.Y - CellReach; Y <= RailCell.Y + CellReach; Y++)
+			{
+				for (int32 Z = RailCell.Z - CellReach; Z <= RailCell.Z + CellReach; Z++)
+				{
+					const FIntVector Cell(X, Y, Z);
+
+					bool bAlreadyVisited = false;
+					VisitedCells.Add(Cell, &bAlreadyVisited);
+					if (bAlreadyVisited)
+					{
+						continue;
+					}
+
+					const TArray<FRailSegmentRef>* Segments = Cells.Find(Cell);
+					if (!Segments)
+					{
+						continue;
+					}
+
+					for (const FRailSegmentRef& Ref : *Segments)
+					{
+						AGrindRail* Rail = Ref.Rail;
+						if (Rail == ChangedRail || PendingSideRailTables.Contains(Rail))
+						{
+							continue;
+						}
+
+						const FBox SearchBounds = RegisteredRails.FindChecked(Rail).Bounds.ExpandBy(Rail->GetSideRailSearchReach());
+						if (SearchBounds.Intersect(Bounds))
+						{
+							Rail->MarkSideRailTableStale();
+							PendingSideRailTables.Add(Rail);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (PendingSideRailTables.Num() > 0)
+	{
+		RequestSideRailTableRebuild();
+	}
+}
+
+void UGrindRailSubsystem::RebuildSideRailTables()
+{
+	bSideRailRebuildPending = false;
+
+	TSet<AGrindRail*> StaleRails = MoveTemp(PendingSideRailTables);
+	PendingSideRailTables.Reset();
+
+	// FindSideRail may have rebuilt some already
+	for (AGrindRail* Rail : StaleRails)
+	{
+		if (Rail->IsSideRailTableStale())
+		{
+			Rail->BuildSideRailTable();
+		}
+	}
+}
+
+void UGrindRailSubsystem::RequestSideRailTableRebuild()
+{
+	// Rails register one at a time while the level begins play, wait for all of them before finding neighbours
+	if (!bSideRailRebuildPending && !GetWorld()->bIsTearingDown)
+	{
+		bSideRailRebuildPending = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UGrindRailSubsystem::RebuildSideRailTables);
+	}
+}
+
+void UGrindRailSubsystem::Deinitialize()
+{
+	Rails.Empty();
+	Cells.Empty();
+	RegisteredRails.Empty();
+	PendingSideRailTables.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntVector UGrindRailSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / CellSize),
+		FMath::FloorToInt32(Location.Y / CellSize),
+		FMath::FloorToInt32(Location.Z / CellSize));
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HomingTargetComponent.h"
+#include "HomingTargetSubsystem.h"
+
+// Sets default values for this component's properties
+UHomingTargetComponent::UHomingTargetComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+// Called when the game starts
+void UHomingTargetComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UHomingTargetSubsystem* HomingSubsystem = GetWorld()->GetSubsystem<UHomingTargetSubsystem>())
+	{
+		HomingSubsystem->RegisterTarget(GetOwner());
+	}
+}
+
+void UHomingTargetComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UHomingTargetSubsystem* HomingSubsystem = GetWorld()->GetSubsystem<UHomingTargetSubsystem>())
+	{
+		HomingSubsystem->UnregisterTarget(GetOwner());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
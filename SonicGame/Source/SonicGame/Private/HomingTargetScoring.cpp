@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HomingTargetScoring.h"
+
+void FHomingCandidateBatch::Reset()
+{
+	X.Reset();
+	Y.Reset();
+	Z.Reset();
+	NumCandidates = 0;
+}
+
+void FHomingCandidateBatch::Add(const FVector& Location)
+{
+	if (NumCandidates == X.Num())
+	{
+		// Grow a whole vector register at a time, unused lanes sit far outside any homing radius
+		constexpr float PaddingCoordinate = 1.0e15f;
+		for (int32 Lane = 0; Lane < 4; Lane++)
+		{
+			X.Add(PaddingCoordinate);
+			Y.Add(PaddingCoordinate);
+			Z.Add(PaddingCoordinate);
+		}
+	}
+
+	X[NumCandidates] = (float)Location.X;
+	Y[NumCandidates] = (float)Location.Y;
+	Z[NumCandidates] = (float)Location.Z;
+	NumCandidates++;
+}
+
+int32 FHomingCandidateBatch::FindBest(const FHomingScoringParams& Params, float& OutFacingCos) const
+{
+	const VectorRegister4Float OriginX = VectorSetFloat1((float)Params.Origin.X);
+	const VectorRegister4Float OriginY = VectorSetFloat1((float)Params.Origin.Y);
+	const VectorRegister4Float OriginZ = VectorSetFloat1((float)Params.Origin.Z);
+
+	const VectorRegister4Float ForwardX = VectorSetFloat1((float)Params.Forward.X);
+	const VectorRegister4Float ForwardY = VectorSetFloat1((float)Params.Forward.Y);
+	const VectorRegister4Float ForwardZ = VectorSetFloat1((float)Params.Forward.Z);
+
+	const VectorRegister4Float CameraX = VectorSetFloat1((float)Params.CameraForward.X);
+	const VectorRegister4Float CameraY = VectorSetFloat1((float)Params.CameraForward.Y);
+	const VectorRegister4Float CameraZ = VectorSetFloat1((float)Params.CameraForward.Z);
+
+	const VectorRegister4Float RadiusSq = VectorSetFloat1(FMath::Square(Params.Radius));
+	const VectorRegister4Float InvRadius = VectorSetFloat1(Params.Radius > 0.0f ? 1.0f / Params.Radius : 0.0f);
+	const VectorRegister4Float MinViewCos = VectorSetFloat1(Params.MinViewCos);
+	const VectorRegister4Float DistanceWeight = VectorSetFloat1(Params.DistanceWeight);
+	const VectorRegister4Float FacingWeight = VectorSetFloat1(Params.FacingWeight);
+	const VectorRegister4Float CameraWeight = VectorSetFloat1(Params.CameraWeight);
+	const VectorRegister4Float One = VectorSetFloat1(1.0f);
+	const VectorRegister4Float MinDistSq = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	float BestScore = -BIG_NUMBER;
+	int32 BestIndex = INDEX_NONE;
+	OutFacingCos = -1.0f;
+
+	alignas(16) float Scores[4];
+	alignas(16) float FacingCos[4];
+
+	for (int32 Index = 0; Index < NumCandidates; Index += 4)
+	{
+		const VectorRegister4Float DeltaX = VectorSubtract(VectorLoadAligned(X.GetData() + Index), OriginX);
+		const VectorRegister4Float DeltaY = VectorSubtract(VectorLoadAligned(Y.GetData() + Index), OriginY);
+		const VectorRegister4Float DeltaZ = VectorSubtract(VectorLoadAligned(Z.GetData() + Index), OriginZ);
+
+		const VectorRegister4Float DistSq = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+		const VectorRegister4Float InvDist = VectorReciprocalSqrtAccurate(VectorMax(DistSq, MinDistSq));
+
+		// Cosines against the player and camera forward vectors, the view cone is tested on these directly
+		const VectorRegister4Float Facing = VectorMultiply(VectorMultiplyAdd(DeltaX, ForwardX, VectorMultiplyAdd(DeltaY, ForwardY, VectorMultiply(DeltaZ, ForwardZ))), InvDist);
+		const VectorRegister4Float Camera = VectorMultiply(VectorMultiplyAdd(DeltaX, CameraX, VectorMultiplyAdd(DeltaY, CameraY, VectorMultiply(DeltaZ, CameraZ))), InvDist);
+
+		const VectorRegister4Float InRange = VectorBitwiseAnd(VectorCompareLE(DistSq, RadiusSq), VectorCompareGE(Facing, MinViewCos));
+		if (VectorMaskBits(InRange) == 0)
+		{
+			continue;
+		}
+
+		const VectorRegister4Float Closeness = VectorSubtract(One, VectorMultiply(VectorMultiply(DistSq, InvDist), InvRadius));
+		const VectorRegister4Float Score = VectorMultiplyAdd(Closeness, DistanceWeight, VectorMultiplyAdd(Facing, FacingWeight, VectorMultiply(Camera, CameraWeight)));
+
+		VectorStoreAligned(VectorSelect(InRange, Score, VectorSetFloat1(-BIG_NUMBER)), Scores);
+		VectorStoreAligned(Facing, FacingCos);
+
+		for (int32 Lane = 0; Lane < 4; Lane++)
+		{
+			if (Scores[Lane] > BestScore)
+			{
+				BestScore = Scores[Lane];
+				BestIndex = Index + Lane;
+				OutFacingCos = FacingCos[Lane];
+			}
+		}
+	}
+
+	return BestIndex;
+}
@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HomingTargetSubsystem.h"
+#include "SonicGame.h"
+#include "GameFramework/Actor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Homing Search"), STAT_SonicHomingSearch, STATGROUP_SonicGame);
+
+void UHomingTargetSubsystem::RegisterTarget(AActor* Target)
+{
+	if (!Target || TargetIndices.Contains(Target))
+	{
+		return;
+	}
+
+	const FVector Location = Target->GetActorLocation();
+
+	const int32 EntryIndex = Targets.Add({ Target, Location, GetCell(Location) });
+	TargetIndices.Add(Target, EntryIndex);
+	AddToCell(EntryIndex);
+}
+
+void UHomingTargetSubsystem::UnregisterTarget(AActor* Target)
+{
+	int32 EntryIndex = INDEX_NONE;
+	if (TargetIndices.RemoveAndCopyValue(Target, EntryIndex))
+	{
+		RemoveEntry(EntryIndex);
+	}
+}
+
+void UHomingTargetSubsystem::GatherTargetsInRadius(const FVector& Location, float Radius, TArray<AActor*>& OutTargets, const AActor* IgnoreActor) const
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicHomingSearch);
+
+	const FIntVector MinCell = GetCell(Location - FVector(Radius));
+	const FIntVector MaxCell = GetCell(Location + FVector(Radius));
+	const float RadiusSq = FMath::Square(Radius);
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				const TArray<int32>* CellEntries = Cells.Find(FIntVector(X, Y, Z));
+				if (!CellEntries)
+				{
+					continue;
+				}
+
+				for (const int32 EntryIndex : *CellEntries)
+				{
+					// Targets can be destroyed at any point between two ticks, e.g. by a homing attack landing
+					AActor* Target = Targets[EntryIndex].Actor.Get();
+					if (!IsValid(Target) || Target->IsActorBeingDestroyed() || Target == IgnoreActor)
+					{
+						continue;
+					}
+
+					if (FVector::DistSquared(Target->GetActorLocation(), Location) <= RadiusSq)
+					{
+						OutTargets.Add(Target);
+					}
+				}
+			}
+		}
+	}
+}
+
+AActor* UHomingTargetSubsystem::FindNearestTarget(const FVector& Location, float Radius, const AActor* IgnoreActor) const
+{
+	TArray<AActor*> Candidates;
+	GatherTargetsInRadius(Location, Radius, Candidates, IgnoreActor);
+
+	AActor* NearestTarget = nullptr;
+	float ShortestDistSq = FMath::Square(Radius);
+
+	for (AActor* Candidate : Candidates)
+	{
+		const float DistSq = FVector::DistSquared(Candidate->GetActorLocation(), Location);
+		if (DistSq < ShortestDistSq)
+		{
+			ShortestDistSq = DistSq;
+			NearestTarget = Candidate;
+		}
+	}
+
+	return NearestTarget;
+}
+
+void UHomingTargetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Move targets between cells as they move, and drop any that were destroyed without unregistering
+	for (int32 EntryIndex = Targets.Num() - 1; EntryIndex >= 0; EntryIndex--)
+	{
+		FHomingTargetEntry& Entry = Targets[EntryIndex];
+
+		AActor* Target = Entry.Actor.Get();
+		if (!IsValid(Target))
+		{
+			TargetIndices.Remove(Entry.Actor);
+			RemoveEntry(EntryIndex);
+			continue;
+		}
+
+		Entry.Location = Target->GetActorLocation();
+
+		const FIntVector NewCell = GetCell(Entry.Location);
+		if (NewCell != Entry.Cell)
+		{
+			RemoveFromCell(EntryIndex);
+			Entry.Cell = NewCell;
+			AddToCell(EntryIndex);
+		}
+	}
+}
+
+TStatId UHomingTargetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHomingTargetSubsystem, STATGROUP_Tickables);
+}
+
+void UHomingTargetSubsystem::Deinitialize()
+{
+	Targets.Empty();
+	Cells.Empty();
+	TargetIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntVector UHomingTargetSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / CellSize),
+		FMath::FloorToInt32(Location.Y / CellSize),
+		FMath::FloorToInt32(Location.Z / CellSize));
+}
+
+void UHomingTargetSubsystem::AddToCell(int32 EntryIndex)
+{
+	Cells.FindOrAdd(Targets[EntryIndex].Cell).Add(EntryIndex);
+}
+
+void UHomingTargetSubsystem::RemoveFromCell(int32 EntryIndex)
+{
+	const FIntVector Cell = Targets[EntryIndex].Cell;
+	if (TArray<int32>* CellEntries = Cells.Find(Cell))
+	{
+		CellEntries->RemoveSingleSwap(EntryIndex);
+		if (CellEntries->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+void UHomingTargetSubsystem::RemoveEntry(int32 EntryIndex)
+{
+	RemoveFromCell(EntryIndex);
+
+	// Fill the hole with the last entry so the list stays dense
+	const int32 LastIndex = Targets.Num() - 1;
+	if (EntryIndex != LastIndex)
+	{
+		RemoveFromCell(LastIndex);
+		Targets[EntryIndex] = Targets[LastIndex];
+		AddToCell(EntryIndex);
+		TargetIndices.Add(Targets[EntryIndex].Actor, EntryIndex);
+	}
+
+	Targets.Pop(false);
+}
@@ -6,8 +6,8 @@
 // Sets default values
 AProjectionActorBase::AProjectionActorBase()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Movement happens in Blueprint. Blueprint subclasses that implement Event Tick still get a tick.
+	PrimaryActorTick.bCanEverTick = false;
 
 	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Mesh"));
 	Mesh->SetupAttachment(RootComponent);
@@ -20,10 +20,34 @@ void AProjectionActorBase::BeginPlay()
 	
 }
 
-// Called every frame
-void AProjectionActorBase::Tick(float DeltaTime)
+void AProjectionActorBase::ActivateFromPool(const FTransform& Transform, const FVector& InStartLocation, const FVector& InTargetDirection)
 {
-	Super::Tick(DeltaTime);
+	bInPool = false;
 
+	StartLocation = InStartLocation;
+	TargetDirection = InTargetDirection;
+	TargetLocation = FVector::ZeroVector;
+	bCanMove = false;
+
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(PrimaryActorTick.bStartWithTickEnabled);
+	Mesh->SetComponentTickEnabled(true);
+
+	OnReusedFromPool();
+}
+
+void AProjectionActorBase::DeactivateToPool()
+{
+	bInPool = true;
+	bCanMove = false;
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+	Mesh->SetComponentTickEnabled(false);
+
+	OnReturnedToPool();
 }
 
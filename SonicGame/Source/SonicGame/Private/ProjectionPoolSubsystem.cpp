@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectionPoolSubsystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "ProjectionActorBase.h"
+
+void UProjectionPoolSubsystem::PrewarmProjections(TSubclassOf<AProjectionActorBase> ProjectionClass, int32 Count)
+{
+	if (!ProjectionClass)
+	{
+		return;
+	}
+
+	FProjectionPool& Pool = Pools.FindOrAdd(ProjectionClass);
+	while (Pool.FreeProjections.Num() < Count)
+	{
+		AProjectionActorBase* Projection = SpawnProjection(ProjectionClass, FTransform::Identity, FVector::ZeroVector);
+		if (!Projection)
+		{
+			return;
+		}
+
+		Projection->DeactivateToPool();
+		Pool.FreeProjections.Add(Projection);
+		Stats.NumPooled++;
+	}
+}
+
+AProjectionActorBase* UProjectionPoolSubsystem::AcquireProjection(TSubclassOf<AProjectionActorBase> ProjectionClass, const FTransform& Transform, const FVector& StartLocation, const FVector& TargetDirection)
+{
+	if (!ProjectionClass)
+	{
+		return nullptr;
+	}
+
+	FProjectionPool& Pool = Pools.FindOrAdd(ProjectionClass);
+	while (Pool.FreeProjections.Num() > 0)
+	{
+		AProjectionActorBase* Projection = Pool.FreeProjections.Pop(false);
+		Stats.NumPooled--;
+
+		// Pooled actors can still be destroyed from outside, e.g. by a level unload
+		if (IsValid(Projection))
+		{
+			Projection->ActivateFromPool(Transform, StartLocation, TargetDirection);
+			Stats.PoolHits++;
+			Stats.NumActive++;
+			return Projection;
+		}
+	}
+
+	AProjectionActorBase* Projection = SpawnProjection(ProjectionClass, Transform, StartLocation);
+	if (Projection)
+	{
+		Projection->TargetDirection = TargetDirection;
+		Stats.PoolMisses++;
+		Stats.NumActive++;
+	}
+
+	return Projection;
+}
+
+void UProjectionPoolSubsystem::ReleaseProjection(AProjectionActorBase* Projection)
+{
+	if (!IsValid(Projection) || Projection->IsInPool())
+	{
+		return;
+	}
+
+	Projection->DeactivateToPool();
+	Pools.FindOrAdd(Projection->GetClass()).FreeProjections.Add(Projection);
+	Stats.NumPooled++;
+	Stats.NumActive = FMath::Max(Stats.NumActive - 1, 0);
+}
+
+void UProjectionPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	Stats = FProjectionPoolStats();
+
+	Super::Deinitialize();
+}
+
+AProjectionActorBase* UProjectionPoolSubsystem::SpawnProjection(TSubclassOf<AProjectionActorBase> ProjectionClass, const FTransform& Transform, const FVector& StartLocation)
+{
+	// StartLocation has to be set before BeginPlay runs, so spawn deferred
+	AProjectionActorBase* Projection = Cast<AProjectionActorBase>(UGameplayStatics::BeginDeferredActorSpawnFromClass(GetWorld(), ProjectionClass, Transform, ESpawnActorCollisionHandlingMethod::AlwaysSpawn));
+	if (Projection)
+	{
+		Projection->StartLocation = StartLocation;
+		UGameplayStatics::FinishSpawningActor(Projection, Transform);
+	}
+
+	return Projection;
+}
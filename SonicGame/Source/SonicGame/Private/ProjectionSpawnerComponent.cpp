@@ -2,13 +2,22 @@
 
 
 #include "ProjectionSpawnerComponent.h"
+#include "SonicGame.h"
+#include "SonicPerfTracker.h"
 #include "Kismet/GameplayStatics.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "ProjectionActorBase.h"
+#include "ProjectionPoolSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spawn Projection"), STAT_SonicSpawnProjection, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Projection Swarm Update"), STAT_SonicProjectionSwarmUpdate, STATGROUP_SonicGame);
 
 // Sets default values for this component's properties
 UProjectionSpawnerComponent::UProjectionSpawnerComponent()
 {
-	
+	// Only ticks while swarm projections are moving
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
 
@@ -25,14 +34,30 @@ void UProjectionSpawnerComponent::SpawnProjectionInCircle(TSubclassOf<AActor> Ac
 
 void UProjectionSpawnerComponent::ClearAllActiveProjections()
 {
+	UProjectionPoolSubsystem* ProjectionPool = bUseProjectionPool ? GetWorld()->GetSubsystem<UProjectionPoolSubsystem>() : nullptr;
+
 	for(AProjectionActorBase* Projection : ActiveProjections)
 	{
 		if(Projection)
 		{
-			Projection->Destroy();
+			if(ProjectionPool)
+			{
+				ProjectionPool->ReleaseProjection(Projection);
+			}
+			else
+			{
+				Projection->Destroy();
+			}
 		}
 	}
 	ActiveProjections.Empty();
+
+	ProjectionSwarm.Reset();
+	if(SwarmInstances)
+	{
+		SwarmInstances->ClearInstances();
+	}
+	SetComponentTickEnabled(false);
 }
 
 void UProjectionSpawnerComponent::SpawnProjection(int32 NumProjections, TSubclassOf<AActor> ActorToSpawn, float Distance, const float AdditionalRotationAngle)
@@ -66,6 +91,26 @@ void UProjectionSpawnerComponent::SpawnProjection(int32 NumProjections, TSubclas
 
 void UProjectionSpawnerComponent::SpawnDeferredProjection(TSubclassOf<AActor> ActorToSpawn, const FTransform& Transform, const FVector TargetLocation)
 {
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicSpawnProjection);
+	SONIC_PERF_SCOPE(ProjectionSpawning);
+
+	if(CanUseProjectionSwarm())
+	{
+		AddSwarmProjection(Transform, TargetLocation);
+		return;
+	}
+
+	UProjectionPoolSubsystem* ProjectionPool = bUseProjectionPool ? GetWorld()->GetSubsystem<UProjectionPoolSubsystem>() : nullptr;
+	const TSubclassOf<AProjectionActorBase> ProjectionClass = *ActorToSpawn;
+	if(ProjectionPool && ProjectionClass)
+	{
+		if(AProjectionActorBase* PooledProjection = ProjectionPool->AcquireProjection(ProjectionClass, Transform, TargetLocation, RotationAxis))
+		{
+			ActiveProjections.Add(PooledProjection);
+		}
+		return;
+	}
+
 	AProjectionActorBase* SpawnedProjection = Cast<AProjectionActorBase>(UGameplayStatics::BeginDeferredActorSpawnFromClass(GetWorld(), ActorToSpawn, Transform));
 	SpawnedProjection->StartLocation = TargetLocation;
 	UGameplayStatics::FinishSpawningActor(SpawnedProjection, Transform);
@@ -73,12 +118,63 @@ void UProjectionSpawnerComponent::SpawnDeferredProjection(TSubclassOf<AActor> Ac
 	ActiveProjections.Add(SpawnedProjection);
 }
 
+bool UProjectionSpawnerComponent::CanUseProjectionSwarm() const
+{
+	return bUseProjectionSwarm && SwarmMesh != nullptr;
+}
+
+void UProjectionSpawnerComponent::AddSwarmProjection(const FTransform& Transform, const FVector TargetLocation)
+{
+	if(!SwarmInstances)
+	{
+		// Left unattached at the origin so instance transforms are world transforms
+		SwarmInstances = NewObject<UInstancedStaticMeshComponent>(GetOwner(), TEXT("ProjectionSwarmInstances"));
+		SwarmInstances->SetStaticMesh(SwarmMesh);
+		SwarmInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		SwarmInstances->SetCastShadow(false);
+		SwarmInstances->RegisterComponent();
+	}
+
+	const int32 Index = ProjectionSwarm.Add(Transform, TargetLocation, SwarmInterpSpeed);
+
+	SwarmInstances->AddInstance(ProjectionSwarm.GetTransform(Index), true);
+
+	SetComponentTickEnabled(true);
+}
+
+void UProjectionSpawnerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicProjectionSwarmUpdate);
+	SONIC_PERF_SCOPE(ProjectionSpawning);
+
+	ProjectionSwarm.Update(DeltaTime);
+
+	if(SwarmInstances && ProjectionSwarm.Num() > 0)
+	{
+		ProjectionSwarm.GetTransforms(SwarmTransforms);
+		SwarmInstances->BatchUpdateInstancesTransforms(0, SwarmTransforms, true, true, true);
+	}
+
+	// Settled projections stay drawn where they stopped, nothing left to update
+	if(ProjectionSwarm.NumMoving() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
 // Called when the game starts
 void UProjectionSpawnerComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
-	
+	if(bUseProjectionPool && PrewarmProjectionClass && NumPrewarmedProjections > 0)
+	{
+		if(UProjectionPoolSubsystem* ProjectionPool = GetWorld()->GetSubsystem<UProjectionPoolSubsystem>())
+		{
+			ProjectionPool->PrewarmProjections(PrewarmProjectionClass, NumPrewarmedProjections);
+		}
+	}
 }
 
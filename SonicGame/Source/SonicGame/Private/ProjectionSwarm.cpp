@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectionSwarm.h"
+
+void FProjectionSwarm::Reset()
+{
+	Positions.Reset();
+	Targets.Reset();
+	Rotations.Reset();
+	Scales.Reset();
+	InterpSpeeds.Reset();
+	Moving.Reset();
+	NumMovingProjections = 0;
+}
+
+int32 FProjectionSwarm::Add(const FTransform& SpawnTransform, const FVector& TargetLocation, float InterpSpeed)
+{
+	const FVector Start = SpawnTransform.GetLocation();
+	const FVector Travel = TargetLocation - Start;
+
+	Positions.Add(Start);
+	Targets.Add(TargetLocation);
+	Rotations.Add(Travel.IsNearlyZero() ? SpawnTransform.GetRotation() : Travel.ToOrientationQuat());
+	Scales.Add(SpawnTransform.GetScale3D());
+	InterpSpeeds.Add(InterpSpeed);
+	Moving.Add(true);
+	NumMovingProjections++;
+
+	return Positions.Num() - 1;
+}
+
+void FProjectionSwarm::Update(float DeltaTime)
+{
+	if (NumMovingProjections == 0 || DeltaTime <= 0.0f)
+	{
+		return;
+	}
+
+	// Same as FMath::VInterpTo, without the per-call overhead
+	for (int32 Index = 0; Index < Positions.Num(); Index++)
+	{
+		if (!Moving[Index])
+		{
+			continue;
+		}
+
+		const FVector ToTarget = Targets[Index] - Positions[Index];
+		if (ToTarget.SizeSquared() < KINDA_SMALL_NUMBER || InterpSpeeds[Index] <= 0.0f)
+		{
+			Positions[Index] = Targets[Index];
+			Moving[Index] = false;
+			NumMovingProjections--;
+			continue;
+		}
+
+		Positions[Index] += ToTarget * FMath::Clamp(DeltaTime * InterpSpeeds[Index], 0.0f, 1.0f);
+	}
+}
+
+void FProjectionSwarm::GetTransforms(TArray<FTransform>& OutTransforms) const
+{
+	OutTransforms.Reset(Positions.Num());
+	for (int32 Index = 0; Index < Positions.Num(); Index++)
+	{
+		OutTransforms.Emplace(Rotations[Index], Positions[Index], Scales[Index]);
+	}
+}
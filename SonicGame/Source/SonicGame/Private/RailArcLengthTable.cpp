@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RailArcLengthTable.h"
+#include "Components/SplineComponent.h"
+
+void FRailArcLengthTable::Build(const USplineComponent* Spline, float InSampleSpacing)
+{
+	Reset();
+
+	if (!Spline)
+	{
+		return;
+	}
+
+	SampleSpacing = FMath::Max(InSampleSpacing, 1.0f);
+	RailLength = Spline->GetSplineLength();
+	SplineVersion = Spline->SplineCurves.Version;
+	SplineTransform = Spline->GetComponentTransform();
+
+	if (RailLength <= 0.0f)
+	{
+		return;
+	}
+
+	const int32 NumSamples = GetNumSamples(RailLength, SampleSpacing);
+	Samples.Reserve(NumSamples);
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		Samples.Add(Spline->GetLocationAtDistanceAlongSpline(GetDistanceAtSample(i), ESplineCoordinateSpace::World));
+	}
+
+	const int32 NumSegments = Samples.Num() - 1;
+
+	// Measure how far the polyline strays from the spline so callers know the error bound
+	for (int32 i = 0; i < NumSegments; i++)
+	{
+		const float MidDistance = (GetDistanceAtSample(i) + GetDistanceAtSample(i + 1)) * 0.5f;
+		const FVector MidOnSpline = Spline->GetLocationAtDistanceAlongSpline(MidDistance, ESplineCoordinateSpace::World);
+		const FVector MidOnChord = (Samples[i] + Samples[i + 1]) * 0.5f;
+		MaxError = FMath::Max(MaxError, (float)FVector::Dist(MidOnSpline, MidOnChord));
+	}
+
+	BuildTree();
+}
+
+void FRailArcLengthTable::BuildFromSamples(const USplineComponent* Spline, TArray<FVector>&& InSamples, float InSampleSpacing, float InRailLength, float InMaxError)
+{
+	Reset();
+
+	if (!Spline)
+	{
+		return;
+	}
+
+	SampleSpacing = FMath::Max(InSampleSpacing, 1.0f);
+	RailLength = InRailLength;
+	MaxError = InMaxError;
+	SplineVersion = Spline->SplineCurves.Version;
+	SplineTransform = Spline->GetComponentTransform();
+
+	if (RailLength <= 0.0f || InSamples.Num() != GetNumSamples(RailLength, SampleSpacing))
+	{
+		return;
+	}
+
+	Samples = MoveTemp(InSamples);
+
+	BuildTree();
+}
+
+int32 FRailArcLengthTable::GetNumSamples(float InRailLength, float InSampleSpacing)
+{
+	// One sample every SampleSpacing units, plus one at the very end of the rail
+	return FMath::FloorToInt(InRailLength / FMath::Max(InSampleSpacing, 1.0f)) + 2;
+}
+
+void FRailArcLengthTable::BuildTree()
+{
+	const int32 NumSegments = Samples.Num() - 1;
+
+	NumLeaves = FMath::RoundUpToPowerOfTwo(FMath::DivideAndRoundUp(NumSegments, SegmentsPerLeaf));
+	Nodes.Init(FBox(ForceInit), NumLeaves * 2);
+
+	for (int32 Leaf = 0; Leaf < NumLeaves; Leaf++)
+	{
+		const int32 FirstSegment = Leaf * SegmentsPerLeaf;
+		const int32 LastSegment = FMath::Min(FirstSegment + SegmentsPerLeaf, NumSegments);
+
+		FBox& LeafBox = Nodes[NumLeaves + Leaf];
+		for (int32 Segment = FirstSegment; Segment < LastSegment; Segment++)
+		{
+			LeafBox += Samples[Segment];
+			LeafBox += Samples[Segment + 1];
+		}
+	}
+
+	for (int32 Node = NumLeaves - 1; Node >= 1; Node--)
+	{
+		Nodes[Node] = Nodes[Node * 2] + Nodes[Node * 2 + 1];
+	}
+}
+
+void FRailArcLengthTable::Reset()
+{
+	Samples.Reset();
+	Nodes.Reset();
+	NumLeaves = 0;
+	RailLength = 0.0f;
+	MaxError = 0.0f;
+}
+
+bool FRailArcLengthTable::IsStale(const USplineComponent* Spline) const
+{
+	if (!Spline || !IsBuilt())
+	{
+		return true;
+	}
+
+	return Spline->SplineCurves.Version != SplineVersion || !Spline->GetComponentTransform().Equals(SplineTransform);
+}
+
+float FRailArcLengthTable::FindClosestDistance(const FVector& Location, float* OutDistanceSq) const
+{
+	if (!IsBuilt())
+	{
+		return -1.0f;
+	}
+
+	float BestDistanceSq = TNumericLimits<float>::Max();
+	float BestDistance = 0.0f;
+	FindClosestInNode(1, Location, BestDistanceSq, BestDistance);
+
+	if (OutDistanceSq)
+	{
+		*OutDistanceSq = BestDistanceSq;
+	}
+
+	return BestDistance;
+}
+
+FVector FRailArcLengthTable::GetLocationAtDistance(float Distance) const
+{
+	if (!IsBuilt())
+	{
+		return FVector::ZeroVector;
+	}
+
+	Distance = FMath::Clamp(Distance, 0.0f, RailLength);
+
+	const int32 Index = FMath::Min(FMath::FloorToInt(Distance / SampleSpacing), Samples.Num() - 2);
+	const float SegmentStart = GetDistanceAtSample(Index);
+	const float SegmentLength = GetDistanceAtSample(Index + 1) - SegmentStart;
+	const float Alpha = SegmentLength > KINDA_SMALL_NUMBER ? (Distance - SegmentStart) / SegmentLength : 0.0f;
+
+	return FMath::Lerp(Samples[Index], Samples[Index + 1], Alpha);
+}
+
+float FRailArcLengthTable::GetDistanceAtSegmentPoint(int32 Segment, const FVector& Point) const
+{
+	const FVector& Start = Samples[Segment];
+	const float ChordLength = FVector::Dist(Start, Samples[Segment + 1]);
+	const float Alpha = ChordLength > KINDA_SMALL_NUMBER ? FVector::Dist(Start, Point) / ChordLength : 0.0f;
+	const float SegmentStart = GetDistanceAtSample(Segment);
+
+	return SegmentStart + (GetDistanceAtSample(Segment + 1) - SegmentStart) * Alpha;
+}
+
+float FRailArcLengthTable::GetDistanceAtSample(int32 Index) const
+{
+	return FMath::Min(Index * SampleSpacing, RailLength);
+}
+
+void FRailArcLengthTable::FindClosestInNode(int32 Node, const FVector& Location, float& BestDistanceSq, float& BestDistance) const
+{
+	const FBox& Bounds = Nodes[Node];
+	if (!Bounds.IsValid || Bounds.ComputeSquaredDistanceToPoint(Location) >= BestDistanceSq)
+	{
+		return;
+	}
+
+	if (Node >= NumLeaves)
+	{
+		FindClosestInLeaf(Node - NumLeaves, Location, BestDistanceSq, BestDistance);
+		return;
+	}
+
+	// Descend into the nearer child first so the farther one is more likely to be pruned
+	const int32 Left = Node * 2;
+	const int32 Right = Left + 1;
+	const float LeftDistanceSq = Nodes[Left].IsValid ? Nodes[Left].ComputeSquaredDistanceToPoint(Location) : TNumericLimits<float>::Max();
+	const float RightDistanceSq = Nodes[Right].IsValid ? Nodes[Right].ComputeSquaredDistanceToPoint(Location) : TNumericLimits<float>::Max();
+
+	if (LeftDistanceSq <= RightDistanceSq)
+	{
+		FindClosestInNode(Left, Location, BestDistanceSq, BestDistance);
+		FindClosestInNode(Right, Location, BestDistanceSq, BestDistance);
+	}
+	else
+	{
+		FindClosestInNode(Right, Location, BestDistanceSq, BestDistance);
+		FindClosestInNode(Left, Location, BestDistanceSq, BestDistance);
+	}
+}
+
+void FRailArcLengthTable::FindClosestInLeaf(int32 Leaf, const FVector& Location, float& BestDistanceSq, float& BestDistance) const
+{
+	const int32 NumSegments = Samples.Num() - 1;
+	const int32 FirstSegment = Leaf * SegmentsPerLeaf;
+	const int32 LastSegment = FMath::Min(FirstSegment + SegmentsPerLeaf, NumSegments);
+
+	for (int32 Segment = FirstSegment; Segment < LastSegment; Segment++)
+	{
+		const FVector& Start = Samples[Segment];
+		const FVector& End = Samples[Segment + 1];
+
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(Location, Start, End);
+		const float DistanceSq = FVector::DistSquared(ClosestPoint, Location);
+
+		if (DistanceSq < BestDistanceSq)
+		{
+			BestDistanceSq = DistanceSq;
+			BestDistance = GetDistanceAtSegmentPoint(Segment, ClosestPoint);
+		}
+	}
+}
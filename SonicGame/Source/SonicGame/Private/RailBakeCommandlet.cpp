@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RailBakeCommandlet.h"
+#include "SonicGame.h"
+#include "RailBakeData.h"
+#include "GrindRail.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/SavePackage.h"
+
+#if WITH_EDITOR
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionHandle.h"
+#include "WorldPartition/WorldPartitionHelpers.h"
+#endif
+
+URailBakeCommandlet::URailBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+#if WITH_EDITOR
+static bool SaveBakedPackage(UPackage* Package, UObject* Asset, const FString& Extension)
+{
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), Extension);
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+
+	if (!UPackage::SavePackage(Package, Asset, *Filename, SaveArgs))
+	{
+		UE_LOG(LogSonicGame, Error, TEXT("Failed to save %s."), *Filename);
+		return false;
+	}
+
+	return true;
+}
+
+/** Bakes every rail of World, loading the ones in World Partition cells, and saves the bake and every package the bake dirtied. */
+static bool BakeWorld(UWorld* World)
+{
+	UWorldPartition* WorldPartition = World->GetWorldPartition();
+
+	// External rails aren't loaded with the map, keep every one of them loaded until the bake is saved
+	TArray<FWorldPartitionReference> RailReferences;
+	if (WorldPartition)
+	{
+		FWorldPartitionHelpers::ForEachActorDesc(WorldPartition, AGrindRail::StaticClass(), [WorldPartition, &RailReferences](const FWorldPartitionActorDesc* ActorDesc)
+			{
+				RailReferences.Emplace(WorldPartition, ActorDesc->GetGuid());
+				return true;
+			});
+	}
+
+	TArray<AGrindRail*> Rails;
+	for (TActorIterator<AGrindRail> It(World); It; ++It)
+	{
+		if (It->GetLevel() == World->PersistentLevel)
+		{
+			Rails.Add(*It);
+		}
+	}
+
+	URailBakeData* BakeData = URailBakeData::BakeRails(World->PersistentLevel, Rails, true);
+	if (!BakeData)
+	{
+		return true;
+	}
+
+	if (!SaveBakedPackage(BakeData->GetOutermost(), BakeData, FPackageName::GetAssetPackageExtension()))
+	{
+		return false;
+	}
+
+	// One File Per Actor rails keep their bake reference in their own packages
+	bool bSavedAll = true;
+	for (AGrindRail* Rail : Rails)
+	{
+		UPackage* RailPackage = Rail->GetExternalPackage();
+		if (RailPackage && RailPackage->IsDirty())
+		{
+			bSavedAll &= SaveBakedPackage(RailPackage, nullptr, FPackageName::GetAssetPackageExtension());
+		}
+	}
+
+	UPackage* MapPackage = World->GetOutermost();
+	if (MapPackage->IsDirty())
+	{
+		bSavedAll &= SaveBakedPackage(MapPackage, World, FPackageName::GetMapPackageExtension());
+	}
+
+	return bSavedAll;
+}
+#endif
+
+int32 URailBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamValues;
+	ParseCommandLine(*Params, Tokens, Switches, ParamValues);
+
+	TArray<FString> MapNames;
+	if (const FString* MapParam = ParamValues.Find(TEXT("Map")))
+	{
+		MapParam->ParseIntoArray(MapNames, TEXT("+"));
+	}
+	else
+	{
+		TArray<FString> MapFiles;
+		const FString Wildcard = FString(TEXT("*")) + FPackageName::GetMapPackageExtension();
+		IFileManager::Get().FindFilesRecursive(MapFiles, *FPaths::ProjectContentDir(), *Wildcard, true, false);
+
+		for (const FString& MapFile : MapFiles)
+		{
+			FString MapName;
+			if (FPackageName::TryConvertFilenameToLongPackageName(MapFile, MapName))
+			{
+				MapNames.Add(MapName);
+			}
+		}
+	}
+
+	int32 NumFailed = 0;
+
+	for (const FString& MapName : MapNames)
+	{
+		UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+		UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+		if (!World)
+		{
+			UE_LOG(LogSonicGame, Error, TEXT("Could not load map %s."), *MapName);
+			NumFailed++;
+			continue;
+		}
+
+		// World Partition only loads external actors into an initialized world
+		World->WorldType = EWorldType::Editor;
+		World->AddToRoot();
+		if (!World->bIsWorldInitialized)
+		{
+			UWorld::InitializationValues InitValues;
+			InitValues.RequiresHitProxies(false);
+			InitValues.ShouldSimulatePhysics(false);
+			InitValues.EnableTraceCollision(false);
+			InitValues.CreateNavigation(false);
+			InitValues.CreateAISystem(false);
+			InitValues.AllowAudioPlayback(false);
+			InitValues.CreatePhysicsScene(true);
+			World->InitWorld(InitValues);
+			World->UpdateWorldComponents(true, false);
+		}
+
+		// Streaming levels are maps of their own and get baked when they are listed or found on disk
+		if (!BakeWorld(World))
+		{
+			NumFailed++;
+		}
+
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	UE_LOG(LogSonicGame, Display, TEXT("Rail bake finished for %d maps, %d failed."), MapNames.Num(), NumFailed);
+
+	return NumFailed > 0 ? 1 : 0;
+#else
+	UE_LOG(LogSonicGame, Error, TEXT("Rails can only be baked in editor builds."));
+	return 1;
+#endif
+}
@@ -0,0 +1,313 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RailBakeData.h"
+#include "SonicGame.h"
+#include "GrindRail.h"
+#include "RailArcLengthTable.h"
+#include "Components/SplineComponent.h"
+#include "Hash/CityHash.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_EDITOR
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#endif
+
+static_assert(sizeof(FRailBakedSample) == 14, "FRailBakedSample is bulk serialized, it must not have padding");
+
+namespace RailBaking
+{
+	static constexpr float MaxLocationValue = 65535.0f;
+
+	static constexpr float MaxOctahedronValue = 32767.0f;
+
+	static void EncodeOctahedron(const FVector& Vector, int16 OutEncoded[2])
+	{
+		const FVector Normal = Vector.GetSafeNormal(SMALL_NUMBER, FVector::ForwardVector);
+		const double InvLength = 1.0 / (FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z));
+
+		double X = Normal.X * InvLength;
+		double Y = Normal.Y * InvLength;
+
+		// Fold the lower half of the octahedron over the upper one
+		if (Normal.Z < 0.0)
+		{
+			const double FoldedX = (1.0 - FMath::Abs(Y)) * (X >= 0.0 ? 1.0 : -1.0);
+			const double FoldedY = (1.0 - FMath::Abs(X)) * (Y >= 0.0 ? 1.0 : -1.0);
+			X = FoldedX;
+			Y = FoldedY;
+		}
+
+		OutEncoded[0] = (int16)FMath::RoundToInt(FMath::Clamp(X, -1.0, 1.0) * MaxOctahedronValue);
+		OutEncoded[1] = (int16)FMath::RoundToInt(FMath::Clamp(Y, -1.0, 1.0) * MaxOctahedronValue);
+	}
+
+	static FVector DecodeOctahedron(const int16 Encoded[2])
+	{
+		double X = Encoded[0] / MaxOctahedronValue;
+		double Y = Encoded[1] / MaxOctahedronValue;
+		const double Z = 1.0 - FMath::Abs(X) - FMath::Abs(Y);
+
+		if (Z < 0.0)
+		{
+			const double UnfoldedX = (1.0 - FMath::Abs(Y)) * (X >= 0.0 ? 1.0 : -1.0);
+			const double UnfoldedY = (1.0 - FMath::Abs(X)) * (Y >= 0.0 ? 1.0 : -1.0);
+			X = UnfoldedX;
+			Y = UnfoldedY;
+		}
+
+		return FVector(X, Y, Z).GetSafeNormal();
+	}
+
+	static FVector DecodeLocation(const FBakedRail& Rail, const FRailBakedSample& Sample)
+	{
+		return FVector(
+			Rail.BoundsMin.X + Sample.Location[0] / MaxLocationValue * Rail.BoundsSize.X,
+			Rail.BoundsMin.Y + Sample.Location[1] / MaxLocationValue * Rail.BoundsSize.Y,
+			Rail.BoundsMin.Z + Sample.Location[2] / MaxLocationValue * Rail.BoundsSize.Z);
+	}
+
+	static float GetDistanceAtSample(const FBakedRail& Rail, int32 Index)
+	{
+		return FMath::Min(Index * Rail.SampleSpacing, Rail.RailLength);
+	}
+}
+
+uint64 URailBakeData::ComputeShapeHash(const USplineComponent* Spline)
+{
+	if (!Spline)
+	{
+		return 0;
+	}
+
+	// Copies, the curve archive operators don't take const curves
+	FInterpCurveVector Position = Spline->SplineCurves.Position;
+	FInterpCurveQuat Rotation = Spline->SplineCurves.Rotation;
+	FVector UpVector = Spline->DefaultUpVector;
+	bool bClosedLoop = Spline->IsClosedLoop();
+	int32 ReparamStepsPerSegment = Spline->ReparamStepsPerSegment;
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Position << Rotation << UpVector << bClosedLoop << ReparamStepsPerSegment;
+
+	return CityHash64((const char*)Bytes.GetData(), Bytes.Num());
+}
+
+bool URailBakeData::IsBakeValidFor(int32 Index, const USplineComponent* Spline, float SampleSpacing) const
+{
+	if (!Spline || !BakedRails.IsValidIndex(Index))
+	{
+		return false;
+	}
+
+	const FBakedRail& Rail = BakedRails[Index];
+	return Rail.SampleSpacing == FMath::Max(SampleSpacing, 1.0f)
+		&& Rail.Samples.Num() == FRailArcLengthTable::GetNumSamples(Rail.RailLength, Rail.SampleSpacing)
+		&& Rail.ShapeHash == ComputeShapeHash(Spline);
+}
+
+void URailBakeData::DecodeLocations(int32 Index, const FTransform& SplineTransform, TArray<FVector>& OutLocations, float& OutMaxError) const
+{
+	const FBakedRail& Rail = BakedRails[Index];
+
+	OutLocations.Reset(Rail.Samples.Num());
+	for (const FRailBakedSample& Sample : Rail.Samples)
+	{
+		OutLocations.Add(SplineTransform.TransformPosition(RailBaking::DecodeLocation(Rail, Sample)));
+	}
+
+	OutMaxError = Rail.MaxError * SplineTransform.GetMaximumAxisScale();
+}
+
+FRailFrame URailBakeData::GetFrameAtDistance(int32 Index, float Distance, const FTransform& SplineTransform) const
+{
+	FRailFrame Frame;
+
+	const FBakedRail& Rail = BakedRails[Index];
+	if (Rail.Samples.Num() < 2)
+	{
+		return Frame;
+	}
+
+	const float ClampedDistance = FMath::Clamp(Distance, 0.0f, Rail.RailLength);
+	const int32 Sample = FMath::Clamp(FMath::FloorToInt(ClampedDistance / Rail.SampleSpacing), 0, Rail.Samples.Num() - 2);
+	const float SegmentStart = RailBaking::GetDistanceAtSample(Rail, Sample);
+	const float SegmentLength = RailBaking::GetDistanceAtSample(Rail, Sample + 1) - SegmentStart;
+	const float Alpha = SegmentLength > KINDA_SMALL_NUMBER ? (ClampedDistance - SegmentStart) / SegmentLength : 0.0f;
+
+	const FRailBakedSample& Start = Rail.Samples[Sample];
+	const FRailBakedSample& End = Rail.Samples[Sample + 1];
+
+	const FVector Location = FMath::Lerp(RailBaking::DecodeLocation(Rail, Start), RailBaking::DecodeLocation(Rail, End), Alpha);
+	const FVector Tangent = FMath::Lerp(RailBaking::DecodeOctahedron(Start.Tangent), RailBaking::DecodeOctahedron(End.Tangent), Alpha);
+	const FVector Up = FMath::Lerp(RailBaking::DecodeOctahedron(Start.Up), RailBaking::DecodeOctahedron(End.Up), Alpha);
+
+	Frame.Location = SplineTransform.TransformPosition(Location);
+	Frame.Tangent = SplineTransform.TransformVector(Tangent).GetSafeNormal();
+	Frame.Rotation = FRotationMatrix::MakeFromXZ(Frame.Tangent, SplineTransform.TransformVector(Up)).ToQuat();
+	Frame.Up = Frame.Rotation.GetUpVector();
+	Frame.Right = Frame.Rotation.GetRightVector();
+	Frame.Roll = Frame.Rotation.Rotator().Roll;
+
+	return Frame;
+}
+
+void URailBakeData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	Ar << BakedRails;
+}
+
+#if WITH_EDITOR
+int32 URailBakeData::AddRail(const USplineComponent* Spline, float SampleSpacing)
+{
+	if (!Spline)
+	{
+		return INDEX_NONE;
+	}
+
+	SampleSpacing = FMath::Max(SampleSpacing, 1.0f);
+	const uint64 ShapeHash = ComputeShapeHash(Spline);
+
+	const int32 ExistingIndex = BakedRails.IndexOfByPredicate([ShapeHash, SampleSpacing](const FBakedRail& Rail)
+		{
+			return Rail.ShapeHash == ShapeHash && Rail.SampleSpacing == SampleSpacing;
+		});
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	FBakedRail Rail;
+	Rail.ShapeHash = ShapeHash;
+	Rail.SampleSpacing = SampleSpacing;
+	Rail.RailLength = Spline->GetSplineLength();
+
+	const int32 NumSamples = FRailArcLengthTable::GetNumSamples(Rail.RailLength, Rail.SampleSpacing);
+
+	TArray<FVector> Locations;
+	Locations.Reserve(NumSamples);
+	FBox Bounds(ForceInit);
+
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		const FVector Location = Spline->GetLocationAtDistanceAlongSpline(RailBaking::GetDistanceAtSample(Rail, i), ESplineCoordinateSpace::Local);
+		Locations.Add(Location);
+		Bounds += Location;
+	}
+
+	// Keep a flat axis from dividing by zero
+	Rail.BoundsMin = FVector3f(Bounds.Min);
+	Rail.BoundsSize = FVector3f::Max(FVector3f(Bounds.GetSize()), FVector3f(1.0f));
+
+	Rail.Samples.SetNum(NumSamples);
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		const float Distance = RailBaking::GetDistanceAtSample(Rail, i);
+		const FVector Normalized = (Locations[i] - FVector(Rail.BoundsMin)) / FVector(Rail.BoundsSize);
+
+		FRailBakedSample& Sample = Rail.Samples[i];
+		Sample.Location[0] = (uint16)FMath::RoundToInt(FMath::Clamp(Normalized.X, 0.0, 1.0) * RailBaking::MaxLocationValue);
+		Sample.Location[1] = (uint16)FMath::RoundToInt(FMath::Clamp(Normalized.Y, 0.0, 1.0) * RailBaking::MaxLocationValue);
+		Sample.Location[2] = (uint16)FMath::RoundToInt(FMath::Clamp(Normalized.Z, 0.0, 1.0) * RailBaking::MaxLocationValue);
+		RailBaking::EncodeOctahedron(Spline->GetDirectionAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local), Sample.Tangent);
+		RailBaking::EncodeOctahedron(Spline->GetUpVectorAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local), Sample.Up);
+	}
+
+	// Same error measure as FRailArcLengthTable::Build, but against the quantized samples
+	Rail.MaxError = (float)(FVector(Rail.BoundsSize) / (2.0f * RailBaking::MaxLocationValue)).Size();
+	for (int32 i = 0; i < NumSamples - 1; i++)
+	{
+		const float MidDistance = (RailBaking::GetDistanceAtSample(Rail, i) + RailBaking::GetDistanceAtSample(Rail, i + 1)) * 0.5f;
+		const FVector MidOnSpline = Spline->GetLocationAtDistanceAlongSpline(MidDistance, ESplineCoordinateSpace::Local);
+		const FVector MidOnChord = (RailBaking::DecodeLocation(Rail, Rail.Samples[i]) + RailBaking::DecodeLocation(Rail, Rail.Samples[i + 1])) * 0.5f;
+		Rail.MaxError = FMath::Max(Rail.MaxError, (float)FVector::Dist(MidOnSpline, MidOnChord));
+	}
+
+	return BakedRails.Add(MoveTemp(Rail));
+}
+
+URailBakeData* URailBakeData::BakeLevel(ULevel* Level)
+{
+	if (!Level)
+	{
+		return nullptr;
+	}
+
+	// Loaded external actors are in the level's actor list too
+	TArray<AGrindRail*> Rails;
+	for (AActor* Actor : Level->Actors)
+	{
+		if (AGrindRail* Rail = Cast<AGrindRail>(Actor))
+		{
+			Rails.Add(Rail);
+		}
+	}
+
+	// Rails in unloaded World Partition cells still point at entries of the asset
+	const UWorld* World = Level->GetWorld();
+	const bool bAllRailsLoaded = !World || !World->IsPartitionedWorld();
+
+	return BakeRails(Level, Rails, bAllRailsLoaded);
+}
+
+URailBakeData* URailBakeData::BakeRails(ULevel* Level, const TArray<AGrindRail*>& InRails, bool bRemoveOldEntries)
+{
+	TArray<AGrindRail*> Rails = InRails.FilterByPredicate([](const AGrindRail* Rail)
+		{
+			return Rail && Rail->RailSpline;
+		});
+
+	if (!Level || Rails.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	const FString LevelPackageName = Level->GetOutermost()->GetName();
+	if (LevelPackageName.StartsWith(TEXT("/Temp/")))
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Save the level before baking its rails."));
+		return nullptr;
+	}
+
+	const FString AssetName = FPackageName::GetShortName(LevelPackageName) + TEXT("_RailBake");
+	const FString PackageName = TEXT("/Game/RailBakes/") + AssetName;
+	const FString ObjectPath = PackageName + TEXT(".") + AssetName;
+
+	URailBakeData* BakeData = FindObject<URailBakeData>(nullptr, *ObjectPath);
+	if (!BakeData && FPackageName::DoesPackageExist(PackageName))
+	{
+		BakeData = LoadObject<URailBakeData>(nullptr, *ObjectPath);
+	}
+
+	if (!BakeData)
+	{
+		UPackage* Package = CreatePackage(*PackageName);
+		BakeData = NewObject<URailBakeData>(Package, *AssetName, RF_Public | RF_Standalone);
+		FAssetRegistryModule::AssetCreated(BakeData);
+	}
+
+	BakeData->Modify();
+	if (bRemoveOldEntries)
+	{
+		BakeData->BakedRails.Reset();
+	}
+
+	for (AGrindRail* Rail : Rails)
+	{
+		Rail->SetRailBake(BakeData, BakeData->AddRail(Rail->RailSpline, Rail->RailSampleSpacing));
+	}
+
+	BakeData->MarkPackageDirty();
+
+	UE_LOG(LogSonicGame, Display, TEXT("Baked %d rails in %s into %d rail shapes in %s."), Rails.Num(), *LevelPackageName, BakeData->BakedRails.Num(), *PackageName);
+
+	return BakeData;
+}
+#endif
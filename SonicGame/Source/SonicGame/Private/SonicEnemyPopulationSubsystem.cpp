@@ -0,0 +1,282 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicEnemyPopulationSubsystem.h"
+#include "SonicGame.h"
+#include "SonicActorRegistry.h"
+#include "Enemy.h"
+#include "SonicGameCharacter.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Population Update"), STAT_SonicEnemyPopulationUpdate, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dormant Enemies"), STAT_SonicDormantEnemies, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Promoted Enemies"), STAT_SonicPromotedEnemies, STATGROUP_SonicGame);
+
+static TAutoConsoleVariable<bool> CVarSonicPopulationEnabled(
+	TEXT("sonic.Population.Enabled"),
+	true,
+	TEXT("Lets enemies with Can Be Dormant set go dormant away from the player. Only affects enemies that begin play afterwards."));
+
+static TAutoConsoleVariable<float> CVarSonicPopulationPromoteDistance(
+	TEXT("sonic.Population.PromoteDistance"),
+	6000.0f,
+	TEXT("Dormant enemies closer than this to the player are spawned as actors. Never less than the player's homing radius plus the distance they cover between updates."));
+
+static TAutoConsoleVariable<float> CVarSonicPopulationDemoteDistance(
+	TEXT("sonic.Population.DemoteDistance"),
+	8000.0f,
+	TEXT("Promoted enemies further than this from the player go dormant again. Never less than a quarter more than the promote distance."));
+
+static TAutoConsoleVariable<float> CVarSonicPopulationUpdatePeriod(
+	TEXT("sonic.Population.UpdatePeriod"),
+	0.25f,
+	TEXT("Seconds between enemy promotion updates."));
+
+void USonicEnemyPopulationSubsystem::AddEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || Enemy->PopulationIndex != INDEX_NONE || !CVarSonicPopulationEnabled.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	// Both are stored in 16 bits
+	int32 ClassIndex = Classes.AddUnique(Enemy->GetClass());
+	int32 LevelIndex = Levels.AddUnique(Enemy->GetLevel());
+	if (ClassIndex > MAX_uint16 || LevelIndex > MAX_uint16)
+	{
+		return;
+	}
+
+	const int32 EntryIndex = Locations.AddUninitialized();
+	Rotations.AddUninitialized();
+	Scales.AddUninitialized();
+	ClassIndices.Add((uint16)ClassIndex);
+	LevelIndices.Add((uint16)LevelIndex);
+	Actors.Add(Enemy);
+
+	Enemy->PopulationIndex = EntryIndex;
+	NumPromoted++;
+	StoreTransform(EntryIndex, Enemy);
+
+	// Go dormant straight away unless the player is already close
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	const float PromoteDistance = GetPromoteDistance(Player);
+	if (!Player || FVector::DistSquared(Player->GetActorLocation(), Enemy->GetActorLocation()) > FMath::Square(PromoteDistance))
+	{
+		Demote(EntryIndex);
+	}
+}
+
+void USonicEnemyPopulationSubsystem::OnEnemyEndPlay(AEnemy* Enemy, EEndPlayReason::Type EndPlayReason)
+{
+	const int32 EntryIndex = Enemy->PopulationIndex;
+	if (!Actors.IsValidIndex(EntryIndex) || Actors[EntryIndex].Get() != Enemy)
+	{
+		return;
+	}
+
+	Enemy->PopulationIndex = INDEX_NONE;
+	Actors[EntryIndex].Reset();
+	NumPromoted--;
+
+	// Killed by the player or gameplay, it must not come back. Level unloads are handled in OnLevelRemovedFromWorld.
+	if (Enemy != DemotingEnemy && EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		RemoveEntry(EntryIndex);
+	}
+}
+
+void USonicEnemyPopulationSubsystem::UpdatePopulation(const FVector& Location, float PromoteDistance, float DemoteDistance)
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicEnemyPopulationUpdate);
+
+	const FVector3f Location3f(Location);
+	const float PromoteDistanceSq = FMath::Square(PromoteDistance);
+	const float DemoteDistanceSq = FMath::Square(DemoteDistance);
+
+	for (int32 EntryIndex = 0; EntryIndex < Locations.Num(); EntryIndex++)
+	{
+		if (const AEnemy* Enemy = Actors[EntryIndex].Get())
+		{
+			if (FVector::DistSquared(Enemy->GetActorLocation(), Location) > DemoteDistanceSq)
+			{
+				Demote(EntryIndex);
+			}
+		}
+		else if (FVector3f::DistSquared(Locations[EntryIndex], Location3f) < PromoteDistanceSq)
+		{
+			Promote(EntryIndex);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SonicDormantEnemies, Locations.Num() - NumPromoted);
+	SET_DWORD_STAT(STAT_SonicPromotedEnemies, NumPromoted);
+}
+
+void USonicEnemyPopulationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const float UpdatePeriod = CVarSonicPopulationUpdatePeriod.GetValueOnGameThread();
+
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < UpdatePeriod)
+	{
+		return;
+	}
+
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (!Player)
+	{
+		return;
+	}
+
+	TimeSinceUpdate = 0.0f;
+
+	const float PromoteDistance = GetPromoteDistance(Player);
+	const float DemoteDistance = FMath::Max(CVarSonicPopulationDemoteDistance.GetValueOnGameThread(), PromoteDistance * 1.25f);
+	UpdatePopulation(Player->GetActorLocation(), PromoteDistance, DemoteDistance);
+}
+
+TStatId USonicEnemyPopulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USonicEnemyPopulationSubsystem, STATGROUP_Tickables);
+}
+
+void USonicEnemyPopulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &USonicEnemyPopulationSubsystem::OnLevelRemovedFromWorld);
+}
+
+void USonicEnemyPopulationSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Locations.Empty();
+	Rotations.Empty();
+	Scales.Empty();
+	ClassIndices.Empty();
+	LevelIndices.Empty();
+	Actors.Empty();
+	Classes.Empty();
+	Levels.Empty();
+	NumPromoted = 0;
+
+	Super::Deinitialize();
+}
+
+void USonicEnemyPopulationSubsystem::Promote(int32 EntryIndex)
+{
+	ULevel* Level = Levels[LevelIndices[EntryIndex]].Get();
+	UClass* EnemyClass = Classes[ClassIndices[EntryIndex]];
+	if (!Level || !EnemyClass)
+	{
+		return;
+	}
+
+	const FTransform Transform(FQuat(Rotations[EntryIndex]), FVector(Locations[EntryIndex]), FVector(Scales[EntryIndex]));
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.OverrideLevel = Level;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.bDeferConstruction = true;
+
+	AEnemy* Enemy = GetWorld()->SpawnActor<AEnemy>(EnemyClass, Transform, SpawnParams);
+	if (!Enemy)
+	{
+		return;
+	}
+
+	// Set before BeginPlay so the enemy doesn't add itself as a new entry
+	Enemy->PopulationIndex = EntryIndex;
+	Actors[EntryIndex] = Enemy;
+	NumPromoted++;
+
+	Enemy->FinishSpawning(Transform);
+}
+
+void USonicEnemyPopulationSubsystem::Demote(int32 EntryIndex)
+{
+	AEnemy* Enemy = Actors[EntryIndex].Get();
+	if (!Enemy)
+	{
+		return;
+	}
+
+	StoreTransform(EntryIndex, Enemy);
+
+	DemotingEnemy = Enemy;
+	Enemy->Destroy();
+	DemotingEnemy = nullptr;
+}
+
+void USonicEnemyPopulationSubsystem::StoreTransform(int32 EntryIndex, const AEnemy* Enemy)
+{
+	const FTransform& Transform = Enemy->GetActorTransform();
+	Locations[EntryIndex] = FVector3f(Transform.GetLocation());
+	Rotations[EntryIndex] = FQuat4f(Transform.GetRotation());
+	Scales[EntryIndex] = FVector3f(Transform.GetScale3D());
+}
+
+void USonicEnemyPopulationSubsystem::RemoveEntry(int32 EntryIndex)
+{
+	SonicRemoveAtSwap(EntryIndex, Locations, Rotations, Scales, ClassIndices, LevelIndices, Actors);
+
+	// Promoted enemies keep their entry index on themselves instead of in a map
+	if (AEnemy* MovedEnemy = Actors.IsValidIndex(EntryIndex) ? Actors[EntryIndex].Get() : nullptr)
+	{
+		MovedEnemy->PopulationIndex = EntryIndex;
+	}
+}
+
+void USonicEnemyPopulationSubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	const int32 LevelIndex = Levels.IndexOfByKey(Level);
+	if (LevelIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// The level's enemies add themselves again if it is loaded back in
+	for (int32 EntryIndex = Locations.Num() - 1; EntryIndex >= 0; EntryIndex--)
+	{
+		if (LevelIndices[EntryIndex] != LevelIndex)
+		{
+			continue;
+		}
+
+		if (AEnemy* Enemy = Actors[EntryIndex].Get())
+		{
+			Enemy->PopulationIndex = INDEX_NONE;
+			NumPromoted--;
+		}
+
+		RemoveEntry(EntryIndex);
+	}
+
+	Levels[LevelIndex].Reset();
+}
+
+float USonicEnemyPopulationSubsystem::GetPromoteDistance(const APawn* Player) const
+{
+	float PromoteDistance = CVarSonicPopulationPromoteDistance.GetValueOnGameThread();
+
+	// Anything the player could home in on before the next update has to be an actor by then
+	if (const ASonicGameCharacter* Character = Cast<ASonicGameCharacter>(Player))
+	{
+		const float ReachBeforeNextUpdate = Character->GetVelocity().Size() * CVarSonicPopulationUpdatePeriod.GetValueOnGameThread() * 2.0f;
+		PromoteDistance = FMath::Max(PromoteDistance, Character->HomingRadius + ReachBeforeNextUpdate);
+	}
+
+	return PromoteDistance;
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicFloorProbe.h"
+#include "SonicGame.h"
+#include "Engine/World.h"
+
+void FSonicFloorProbeCache::Probe(const UWorld* World, const FVector& Origin, const FVector& Up, const FVector& Direction, float SampleSpacing, int32 NumSamples,
+	ECollisionChannel Channel, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams)
+{
+	Invalidate();
+
+	FSonicFloorSample Sample;
+	Sample.Location = Origin;
+	Sample.Normal = Up;
+	Sample.Forward = FVector::VectorPlaneProject(Direction, Up).GetSafeNormal();
+	if (!World || Sample.Forward.IsNearlyZero())
+	{
+		return;
+	}
+
+	Samples.Add(Sample);
+
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		// Step along the last surface found, then look for the ground around where that lands
+		const FVector Ahead = Sample.Location + Sample.Forward * SampleSpacing;
+		const FVector Start = Ahead + Sample.Normal * SampleSpacing;
+		const FVector End = Ahead - Sample.Normal * SampleSpacing;
+
+		INC_DWORD_STAT(STAT_SonicTracesIssued);
+
+		FHitResult Hit;
+		if (!World->LineTraceSingleByChannel(Hit, Start, End, Channel, QueryParams, ResponseParams) || Hit.bStartPenetrating)
+		{
+			break;
+		}
+
+		Sample.Distance += FVector::Dist(Sample.Location, Hit.ImpactPoint);
+		Sample.Location = Hit.ImpactPoint;
+		Sample.Normal = Hit.ImpactNormal;
+		Sample.Forward = FVector::VectorPlaneProject(Sample.Forward, Sample.Normal).GetSafeNormal();
+		if (Sample.Forward.IsNearlyZero())
+		{
+			break;
+		}
+
+		Samples.Add(Sample);
+	}
+
+	if (Samples.Num() < 2)
+	{
+		Samples.Reset();
+	}
+}
+
+void FSonicFloorProbeCache::Invalidate()
+{
+	Samples.Reset();
+	TravelledDistance = 0.0f;
+}
+
+bool FSonicFloorProbeCache::GetFloorAhead(float LeadDistance, FSonicFloorSample& OutSample) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	const float Distance = FMath::Max(TravelledDistance + LeadDistance, 0.0f);
+	if (Distance > Samples.Last().Distance)
+	{
+		return false;
+	}
+
+	// A handful of samples, a linear walk is as fast as anything
+	int32 Segment = 0;
+	while (Segment < Samples.Num() - 2 && Samples[Segment + 1].Distance < Distance)
+	{
+		Segment++;
+	}
+
+	const FSonicFloorSample& Start = Samples[Segment];
+	const FSonicFloorSample& End = Samples[Segment + 1];
+	const float SegmentLength = End.Distance - Start.Distance;
+	const float Alpha = SegmentLength > KINDA_SMALL_NUMBER ? FMath::Clamp((Distance - Start.Distance) / SegmentLength, 0.0f, 1.0f) : 0.0f;
+
+	OutSample.Distance = Distance;
+	OutSample.Location = FMath::Lerp(Start.Location, End.Location, Alpha);
+	OutSample.Normal = FMath::Lerp(Start.Normal, End.Normal, Alpha).GetSafeNormal();
+	OutSample.Forward = FMath::Lerp(Start.Forward, End.Forward, Alpha).GetSafeNormal();
+	return true;
+}
@@ -0,0 +1,474 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicInputReplayComponent.h"
+#include "SonicGame.h"
+#include "Components/InputComponent.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerInput.h"
+#include "HAL/FileManager.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#include "GrindRailSubsystem.h"
+#include "HomingTargetSubsystem.h"
+#include "ProjectionPoolSubsystem.h"
+#include "SonicTickManagerSubsystem.h"
+
+namespace
+{
+	static const uint32 RecordingMagic = 0x534E4952; // 'SNIR'
+	static const int32 RecordingVersion = 2;
+}
+
+void FSonicInputRecording::Reset()
+{
+	MapName.Reset();
+	AxisNames.Reset();
+	ActionNames.Reset();
+	AxisValues.Reset();
+	ActionStates.Reset();
+	FrameDeltaTimes.Reset();
+}
+
+FArchive& operator<<(FArchive& Ar, FSonicInputRecording& Recording)
+{
+	uint32 Magic = RecordingMagic;
+	int32 Version = RecordingVersion;
+	Ar << Magic;
+	Ar << Version;
+
+	if (Magic != RecordingMagic || Version != RecordingVersion)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Recording.MapName;
+	Ar << Recording.AxisNames;
+	Ar << Recording.ActionNames;
+	Ar << Recording.AxisValues;
+	Ar << Recording.ActionStates;
+	Ar << Recording.FrameDeltaTimes;
+	return Ar;
+}
+
+bool FSonicInputRecording::SaveToFile(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << *this;
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FSonicInputRecording::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		return false;
+	}
+
+	Reset();
+
+	FMemoryReader Reader(Bytes);
+	Reader << *this;
+
+	// A recording that doesn't add up can't be replayed frame by frame
+	if (Reader.IsError() || AxisValues.Num() != ActionStates.Num() * AxisNames.Num() || FrameDeltaTimes.Num() != ActionStates.Num() || ActionNames.Num() > MaxActions)
+	{
+		Reset();
+		return false;
+	}
+
+	return true;
+}
+
+FString FSonicInputRecording::GetRecordingPath(const FString& Name)
+{
+	return FPaths::ProjectSavedDir() / TEXT("InputRecordings") / Name + TEXT(".sonicinput");
+}
+
+// Sets default values for this component's properties
+USonicInputReplayComponent::USonicInputReplayComponent()
+{
+	// Only ticks while recording or replaying
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+bool USonicInputReplayComponent::StartRecording(const FString& Name)
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Mode != EMode::None || !Pawn || !Pawn->InputComponent || !SetupTicking(false))
+	{
+		return false;
+	}
+
+	Recording.Reset();
+	Recording.MapName = GetWorld()->GetMapName();
+
+	// Everything bound in SetupPlayerInputComponent, plus any input events the Blueprint added
+	for (const FInputAxisBinding& AxisBinding : Pawn->InputComponent->AxisBindings)
+	{
+		Recording.AxisNames.AddUnique(AxisBinding.AxisName);
+	}
+
+	for (int32 BindingIndex = 0; BindingIndex < Pawn->InputComponent->GetNumActionBindings(); BindingIndex++)
+	{
+		Recording.ActionNames.AddUnique(Pawn->InputComponent->GetActionBinding(BindingIndex).GetActionName());
+	}
+
+	if (Recording.ActionNames.Num() > FSonicInputRecording::MaxActions)
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Input recording only keeps the first %d of %d actions"), FSonicInputRecording::MaxActions, Recording.ActionNames.Num());
+		Recording.ActionNames.SetNum(FSonicInputRecording::MaxActions);
+	}
+
+	RecordingName = Name;
+	Mode = EMode::Recording;
+	SetComponentTickEnabled(true);
+
+	UE_LOG(LogSonicGame, Log, TEXT("Recording input to %s"), *FSonicInputRecording::GetRecordingPath(Name));
+	return true;
+}
+
+void USonicInputReplayComponent::StopRecording()
+{
+	if (Mode != EMode::Recording)
+	{
+		return;
+	}
+
+	Mode = EMode::None;
+	SetComponentTickEnabled(false);
+
+	const FString Filename = FSonicInputRecording::GetRecordingPath(RecordingName);
+	if (Recording.SaveToFile(Filename))
+	{
+		UE_LOG(LogSonicGame, Log, TEXT("Saved %d frames of input to %s"), Recording.GetNumFrames(), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogSonicGame, Error, TEXT("Couldn't save input recording to %s"), *Filename);
+	}
+}
+
+bool USonicInputReplayComponent::StartReplay(const FString& Name)
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Mode != EMode::None || !Pawn || !Pawn->InputComponent || !SetupTicking(true))
+	{
+		return false;
+	}
+
+	const FString Filename = FSonicInputRecording::GetRecordingPath(Name);
+	if (!Recording.LoadFromFile(Filename))
+	{
+		UE_LOG(LogSonicGame, Error, TEXT("Couldn't load input recording %s"), *Filename);
+		return false;
+	}
+
+	if (Recording.MapName != GetWorld()->GetMapName())
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Input recording %s was made on %s, replaying on %s"), *Name, *Recording.MapName, *GetWorld()->GetMapName());
+	}
+
+	// Real input would mix with the replay, stop the controller from feeding the pawn
+	if (APlayerController* PlayerController = Cast<APlayerController>(Pawn->GetController()))
+	{
+		Pawn->DisableInput(PlayerController);
+	}
+
+	RecordingName = Name;
+	CurrentFrame = 0;
+	PreviousActionStates = 0;
+	ReplayFrameTimes.Reset(Recording.GetNumFrames());
+	ReplayStatLines.Reset(Recording.GetNumFrames() + 1);
+	ReplayStatLines.Add(TEXT("frame,frame_ms,speed,rails,homing_targets,batch_ticked_actors,projections_active,projections_pooled"));
+	LastFrameSeconds = FPlatformTime::Seconds();
+
+	Mode = EMode::Replaying;
+	BeginFixedTimeStep(Recording.GetNumFrames() > 0 ? Recording.FrameDeltaTimes[0] : FApp::GetDeltaTime());
+	SetComponentTickEnabled(true);
+
+	UE_LOG(LogSonicGame, Log, TEXT("Replaying %d frames of input from %s"), Recording.GetNumFrames(), *Filename);
+	return true;
+}
+
+void USonicInputReplayComponent::StopReplay()
+{
+	if (Mode != EMode::Replaying)
+	{
+		return;
+	}
+
+	Mode = EMode::None;
+	SetComponentTickEnabled(false);
+	EndFixedTimeStep();
+
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	APlayerController* PlayerController = Pawn ? Cast<APlayerController>(Pawn->GetController()) : nullptr;
+	if (PlayerController)
+	{
+		Pawn->EnableInput(PlayerController);
+	}
+
+	WriteReplayStats();
+
+	if (bQuitWhenReplayEnds)
+	{
+		UKismetSystemLibrary::QuitGame(this, PlayerController, EQuitPreference::Quit, false);
+	}
+}
+
+void USonicInputReplayComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Mode == EMode::Recording)
+	{
+		RecordFrame();
+	}
+	else if (Mode == EMode::Replaying)
+	{
+		if (CurrentFrame >= Recording.GetNumFrames())
+		{
+			StopReplay();
+			return;
+		}
+
+		LogReplayFrame();
+		ReplayFrame();
+		CurrentFrame++;
+
+		// This frame already started, the step set here is used by the frame that replays the next recorded one
+		if (CurrentFrame < Recording.GetNumFrames())
+		{
+			FApp::SetFixedDeltaTime(Recording.FrameDeltaTimes[CurrentFrame]);
+		}
+	}
+}
+
+void USonicInputReplayComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Don't quit because the level is going away
+	bQuitWhenReplayEnds = false;
+
+	StopRecording();
+	StopReplay();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool USonicInputReplayComponent::SetupTicking(bool bBeforeController)
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	AController* Controller = Pawn ? Pawn->GetController() : nullptr;
+	if (!Controller)
+	{
+		return false;
+	}
+
+	// Recording reads the bindings after the controller fed them. A replay feeds them itself, and has to do it before
+	// the controller's PlayerTick turns the rotation input it added into the control rotation.
+	if (bBeforeController)
+	{
+		RemoveTickPrerequisiteActor(Controller);
+		Controller->AddTickPrerequisiteComponent(this);
+	}
+	else
+	{
+		Controller->RemoveTickPrerequisiteComponent(this);
+		AddTickPrerequisiteActor(Controller);
+	}
+
+	// The movement component consumes the input in its own tick
+	if (UPawnMovementComponent* MovementComponent = Pawn->GetMovementComponent())
+	{
+		MovementComponent->AddTickPrerequisiteComponent(this);
+	}
+
+	return true;
+}
+
+void USonicInputReplayComponent::BeginFixedTimeStep(float DeltaTime)
+{
+	bWasUsingFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(DeltaTime);
+}
+
+void USonicInputReplayComponent::EndFixedTimeStep()
+{
+	FApp::SetUseFixedTimeStep(bWasUsingFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+}
+
+void USonicInputReplayComponent::RecordFrame()
+{
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	const APlayerController* PlayerController = Pawn ? Cast<APlayerController>(Pawn->GetController()) : nullptr;
+	if (!PlayerController || !PlayerController->PlayerInput || !Pawn->InputComponent)
+	{
+		return;
+	}
+
+	// Axis bindings hold the value the controller fed them this frame
+	for (const FName& AxisName : Recording.AxisNames)
+	{
+		float AxisValue = 0.0f;
+		for (const FInputAxisBinding& AxisBinding : Pawn->InputComponent->AxisBindings)
+		{
+			if (AxisBinding.AxisName == AxisName)
+			{
+				AxisValue = AxisBinding.AxisValue;
+				break;
+			}
+		}
+		Recording.AxisValues.Add(AxisValue);
+	}
+
+	uint32 ActionState = 0;
+	for (int32 Action = 0; Action < Recording.ActionNames.Num(); Action++)
+	{
+		for (const FInputActionKeyMapping& Mapping : PlayerController->PlayerInput->GetKeysForAction(Recording.ActionNames[Action]))
+		{
+			if (PlayerController->IsInputKeyDown(Mapping.Key))
+			{
+				ActionState |= 1u << Action;
+				break;
+			}
+		}
+	}
+	Recording.ActionStates.Add(ActionState);
+
+	// Undilated, the same value a replay hands the engine as its fixed step
+	Recording.FrameDeltaTimes.Add((float)FApp::GetDeltaTime());
+}
+
+void USonicInputReplayComponent::ReplayFrame()
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	UInputComponent* InputComponent = Pawn ? Pawn->InputComponent.Get() : nullptr;
+	if (!InputComponent)
+	{
+		return;
+	}
+
+	for (int32 Axis = 0; Axis < Recording.AxisNames.Num(); Axis++)
+	{
+		const float AxisValue = Recording.GetAxisValue(CurrentFrame, Axis);
+
+		for (FInputAxisBinding& AxisBinding : InputComponent->AxisBindings)
+		{
+			if (AxisBinding.AxisName == Recording.AxisNames[Axis])
+			{
+				AxisBinding.AxisValue = AxisValue;
+				AxisBinding.AxisDelegate.Execute(AxisValue);
+			}
+		}
+	}
+
+	const uint32 ActionStates = Recording.ActionStates[CurrentFrame];
+	const uint32 ChangedActions = ActionStates ^ PreviousActionStates;
+	PreviousActionStates = ActionStates;
+
+	if (ChangedActions == 0)
+	{
+		return;
+	}
+
+	// Bindings can be added by the callbacks, so walk them by index
+	for (int32 BindingIndex = 0; BindingIndex < InputComponent->GetNumActionBindings(); BindingIndex++)
+	{
+		FInputActionBinding& ActionBinding = InputComponent->GetActionBinding(BindingIndex);
+
+		const int32 Action = Recording.ActionNames.IndexOfByKey(ActionBinding.GetActionName());
+		if (Action == INDEX_NONE || (ChangedActions & (1u << Action)) == 0)
+		{
+			continue;
+		}
+
+		const bool bPressed = (ActionStates & (1u << Action)) != 0;
+		if (ActionBinding.KeyEvent == (bPressed ? IE_Pressed : IE_Released))
+		{
+			ActionBinding.ActionDelegate.Execute(EKeys::Invalid);
+		}
+	}
+}
+
+void USonicInputReplayComponent::LogReplayFrame()
+{
+	// Wall clock time of the whole last frame, the game time step is fixed
+	const double NowSeconds = FPlatformTime::Seconds();
+	const float FrameMs = (float)((NowSeconds - LastFrameSeconds) * 1000.0);
+	LastFrameSeconds = NowSeconds;
+
+	// The first frame includes whatever happened before the replay started
+	if (CurrentFrame > 0)
+	{
+		ReplayFrameTimes.Add(FrameMs);
+	}
+
+	const UWorld* World = GetWorld();
+	const UGrindRailSubsystem* RailSubsystem = World->GetSubsystem<UGrindRailSubsystem>();
+	const UHomingTargetSubsystem* HomingSubsystem = World->GetSubsystem<UHomingTargetSubsystem>();
+	const USonicTickManagerSubsystem* TickManager = World->GetSubsystem<USonicTickManagerSubsystem>();
+	const UProjectionPoolSubsystem* ProjectionPool = World->GetSubsystem<UProjectionPoolSubsystem>();
+	const FProjectionPoolStats PoolStats = ProjectionPool ? ProjectionPool->GetPoolStats() : FProjectionPoolStats();
+
+	const FString StatLine = FString::Printf(TEXT("%d,%.3f,%.1f,%d,%d,%d,%d,%d"),
+		CurrentFrame,
+		FrameMs,
+		GetOwner()->GetVelocity().Size(),
+		RailSubsystem ? RailSubsystem->GetRails().Num() : 0,
+		HomingSubsystem ? HomingSubsystem->GetNumTargets() : 0,
+		TickManager ? TickManager->GetNumRegisteredActors() : 0,
+		PoolStats.NumActive,
+		PoolStats.NumPooled);
+
+	UE_LOG(LogSonicGame, Verbose, TEXT("Input replay %s"), *StatLine);
+	ReplayStatLines.Add(StatLine);
+}
+
+void USonicInputReplayComponent::WriteReplayStats()
+{
+	const FString OutputDir = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("InputReplay");
+	const FString Filename = OutputDir / FString::Printf(TEXT("%s-%s.csv"), *RecordingName, *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+	FFileHelper::SaveStringArrayToFile(ReplayStatLines, *Filename);
+
+	if (ReplayFrameTimes.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<float> SortedFrameTimes = ReplayFrameTimes;
+	SortedFrameTimes.Sort();
+
+	float TotalMs = 0.0f;
+	for (const float FrameMs : SortedFrameTimes)
+	{
+		TotalMs += FrameMs;
+	}
+
+	UE_LOG(LogSonicGame, Log, TEXT("Input replay %s finished: %d frames, mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms. Stats written to %s"),
+		*RecordingName,
+		SortedFrameTimes.Num(),
+		TotalMs / SortedFrameTimes.Num(),
+		SortedFrameTimes[SortedFrameTimes.Num() / 2],
+		SortedFrameTimes[FMath::Min(FMath::FloorToInt32(SortedFrameTimes.Num() * 0.95f), SortedFrameTimes.Num() - 1)],
+		SortedFrameTimes[FMath::Min(FMath::FloorToInt32(SortedFrameTimes.Num() * 0.99f), SortedFrameTimes.Num() - 1)],
+		SortedFrameTimes.Last(),
+		*Filename);
+}
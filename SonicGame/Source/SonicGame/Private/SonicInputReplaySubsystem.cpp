@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicInputReplaySubsystem.h"
+#include "SonicGame.h"
+#include "SonicInputReplayComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSonicInputRecord(
+	TEXT("sonic.input.record"),
+	TEXT("Records the player's input every frame. Usage: sonic.input.record <name>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (USonicInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<USonicInputReplaySubsystem>() : nullptr)
+		{
+			ReplaySubsystem->StartRecording(Args.Num() > 0 ? Args[0] : TEXT("Default"));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSonicInputReplay(
+	TEXT("sonic.input.replay"),
+	TEXT("Plays back a recording in place of the player's input. Usage: sonic.input.replay <name> [quit]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (USonicInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<USonicInputReplaySubsystem>() : nullptr)
+		{
+			ReplaySubsystem->StartReplay(Args.Num() > 0 ? Args[0] : TEXT("Default"), Args.Num() > 1 && Args[1].Equals(TEXT("quit"), ESearchCase::IgnoreCase));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdSonicInputStop(
+	TEXT("sonic.input.stop"),
+	TEXT("Stops the running input recording or replay."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (USonicInputReplaySubsystem* ReplaySubsystem = World ? World->GetSubsystem<USonicInputReplaySubsystem>() : nullptr)
+		{
+			ReplaySubsystem->Stop();
+		}
+	}));
+
+bool USonicInputReplaySubsystem::StartRecording(const FString& Name)
+{
+	USonicInputReplayComponent* ReplayComponent = GetReplayComponent();
+	if (!ReplayComponent || !ReplayComponent->StartRecording(Name))
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Couldn't start recording input, is a local player possessing a pawn?"));
+		return false;
+	}
+
+	return true;
+}
+
+bool USonicInputReplaySubsystem::StartReplay(const FString& Name, bool bQuitWhenDone)
+{
+	USonicInputReplayComponent* ReplayComponent = GetReplayComponent();
+	if (!ReplayComponent)
+	{
+		UE_LOG(LogSonicGame, Warning, TEXT("Couldn't start input replay, is a local player possessing a pawn?"));
+		return false;
+	}
+
+	ReplayComponent->bQuitWhenReplayEnds = bQuitWhenDone;
+	return ReplayComponent->StartReplay(Name);
+}
+
+void USonicInputReplaySubsystem::Stop()
+{
+	PendingRecordName.Reset();
+	PendingReplayName.Reset();
+
+	if (USonicInputReplayComponent* ReplayComponent = GetReplayComponent())
+	{
+		ReplayComponent->StopRecording();
+		ReplayComponent->StopReplay();
+	}
+}
+
+void USonicInputReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FParse::Value(FCommandLine::Get(), TEXT("SonicInputRecord="), PendingRecordName);
+	FParse::Value(FCommandLine::Get(), TEXT("SonicInputReplay="), PendingReplayName);
+	bPendingReplayQuit = FParse::Param(FCommandLine::Get(), TEXT("SonicInputReplayQuit"));
+}
+
+void USonicInputReplaySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingRecordName.IsEmpty() && PendingReplayName.IsEmpty())
+	{
+		return;
+	}
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!PlayerController || !PlayerController->GetPawn())
+	{
+		return;
+	}
+
+	if (!PendingReplayName.IsEmpty())
+	{
+		StartReplay(PendingReplayName, bPendingReplayQuit);
+	}
+	else
+	{
+		StartRecording(PendingRecordName);
+	}
+
+	PendingRecordName.Reset();
+	PendingReplayName.Reset();
+}
+
+TStatId USonicInputReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USonicInputReplaySubsystem, STATGROUP_Tickables);
+}
+
+USonicInputReplayComponent* USonicInputReplaySubsystem::GetReplayComponent() const
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn)
+	{
+		return nullptr;
+	}
+
+	USonicInputReplayComponent* ReplayComponent = Pawn->FindComponentByClass<USonicInputReplayComponent>();
+	if (!ReplayComponent)
+	{
+		ReplayComponent = NewObject<USonicInputReplayComponent>(Pawn, TEXT("InputReplay"));
+		ReplayComponent->RegisterComponent();
+	}
+
+	return ReplayComponent;
+}
@@ -0,0 +1,338 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicMovementReplication.h"
+#include "SonicMovementComponent.h"
+#include "GrindRail.h"
+#include "GameFramework/Character.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+namespace SonicMovementReplication
+{
+	/** Object references go through the package map of the net archive. */
+	template<typename T>
+	static void SerializeObject(FArchive& Ar, T*& Object)
+	{
+		UObject* Value = Object;
+		Ar << Value;
+		Object = Cast<T>(Value);
+	}
+
+	static void SerializeBool(FArchive& Ar, bool& bValue)
+	{
+		uint8 Bit = bValue ? 1 : 0;
+		Ar.SerializeBits(&Bit, 1);
+		bValue = Bit != 0;
+	}
+
+	/** Steps per centimetre the rail distance is sent in. */
+	static constexpr float RailDistanceScale = 4.0f;
+
+	/** Distance along a rail in whole steps of RailDistanceScale, packed so distances near the start take fewer bytes. */
+	static void SerializeRailDistance(FArchive& Ar, float& RailDistance)
+	{
+		uint32 QuantizedDistance = (uint32)FMath::RoundToInt(FMath::Max(RailDistance, 0.0f) * RailDistanceScale);
+		Ar.SerializeIntPacked(QuantizedDistance);
+
+		if (Ar.IsLoading())
+		{
+			RailDistance = QuantizedDistance / RailDistanceScale;
+		}
+	}
+
+	/** Rail, distance and direction, the distance and direction only when there is a rail. */
+	static void SerializeGrindState(FArchive& Ar, AGrindRail*& GrindRail, float& RailDistance, bool& bBackwardsGrind)
+	{
+		bool bHasRail = GrindRail != nullptr;
+		SerializeBool(Ar, bHasRail);
+
+		if (!bHasRail)
+		{
+			GrindRail = nullptr;
+			return;
+		}
+
+		SerializeObject(Ar, GrindRail);
+		SerializeRailDistance(Ar, RailDistance);
+		SerializeBool(Ar, bBackwardsGrind);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSonicNetBandwidth(
+	TEXT("sonic.net.bandwidth"),
+	TEXT("Run on a server. Logs the bytes per second sent to each client over the next few seconds and how many characters were grinding. Usage: sonic.net.bandwidth [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver || !NetDriver->IsServer())
+		{
+			UE_LOG(LogSonicGame, Warning, TEXT("sonic.net.bandwidth has to run on a server"));
+			return;
+		}
+
+		const float Duration = Args.Num() > 0 ? FMath::Max(FCString::Atof(*Args[0]), 1.0f) : 10.0f;
+
+		TArray<TPair<TWeakObjectPtr<UNetConnection>, int64>> StartBytes;
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			StartBytes.Emplace(Connection, Connection->OutTotalBytes);
+		}
+
+		// Grinding is sampled once a second, so the log says how much of the window was spent on rails
+		struct FGrindSamples
+		{
+			int32 NumSamples = 0;
+			int32 NumGrinding = 0;
+		};
+		TSharedRef<FGrindSamples> GrindSamples = MakeShared<FGrindSamples>();
+
+		TWeakObjectPtr<UWorld> WeakWorld = World;
+		FTimerHandle SampleHandle;
+		World->GetTimerManager().SetTimer(SampleHandle, FTimerDelegate::CreateLambda([WeakWorld, GrindSamples]()
+		{
+			if (UWorld* SampledWorld = WeakWorld.Get())
+			{
+				for (TActorIterator<ACharacter> It(SampledWorld); It; ++It)
+				{
+					const USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(It->GetCharacterMovement());
+					GrindSamples->NumSamples++;
+					GrindSamples->NumGrinding += SonicMovement && SonicMovement->IsGrinding() ? 1 : 0;
+				}
+			}
+		}), 1.0f, true, 0.0f);
+
+		FTimerHandle ReportHandle;
+		World->GetTimerManager().SetTimer(ReportHandle, FTimerDelegate::CreateLambda([WeakWorld, StartBytes, GrindSamples, SampleHandle, Duration]() mutable
+		{
+			UWorld* ReportWorld = WeakWorld.Get();
+			if (!ReportWorld)
+			{
+				return;
+			}
+
+			ReportWorld->GetTimerManager().ClearTimer(SampleHandle);
+
+			const IConsoleVariable* RailRelativeVar = IConsoleManager::Get().FindConsoleVariable(TEXT("sonic.net.RailRelativeMovement"));
+			const float GrindingPercent = GrindSamples->NumSamples > 0 ? 100.0f * GrindSamples->NumGrinding / GrindSamples->NumSamples : 0.0f;
+			UE_LOG(LogSonicGame, Display, TEXT("Bandwidth over %.1fs, rail relative movement %s, characters grinding %.0f%% of the time:"),
+				Duration, RailRelativeVar && RailRelativeVar->GetBool() ? TEXT("on") : TEXT("off"), GrindingPercent);
+
+			for (const TPair<TWeakObjectPtr<UNetConnection>, int64>& Start : StartBytes)
+			{
+				if (const UNetConnection* Connection = Start.Key.Get())
+				{
+					UE_LOG(LogSonicGame, Display, TEXT("  %s: %.0f bytes/s"),
+						*Connection->LowLevelGetRemoteAddress(), (Connection->OutTotalBytes - Start.Value) / Duration);
+				}
+			}
+		}), Duration, false);
+	}));
+
+FSavedMove_Sonic::FSavedMove_Sonic()
+	: bWantsRailJump(false)
+	, bWantsHoming(false)
+{
+}
+
+void FSavedMove_Sonic::Clear()
+{
+	Super::Clear();
+
+	bWantsRailJump = false;
+	bWantsHoming = false;
+	RequestedHomingTarget = nullptr;
+	GrindRail = nullptr;
+	RailDistance = 0.0f;
+	bBackwardsGrind = false;
+	HomingTarget = nullptr;
+	HomingPhase = ESonicHomingPhase::None;
+}
+
+uint8 FSavedMove_Sonic::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	if (bWantsRailJump)
+	{
+		Flags |= FLAG_RailJump;
+	}
+
+	if (bWantsHoming)
+	{
+		Flags |= FLAG_Homing;
+	}
+
+	return Flags;
+}
+
+bool FSavedMove_Sonic::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_Sonic* NewSonicMove = static_cast<const FSavedMove_Sonic*>(NewMove.Get());
+
+	// Requests have to reach the server on the move they were made in
+	if (bWantsRailJump || bWantsHoming || NewSonicMove->bWantsRailJump || NewSonicMove->bWantsHoming)
+	{
+		return false;
+	}
+
+	// Getting on or off a rail or changing homing phase starts a new move. The rail distance changes every move.
+	if (GrindRail != NewSonicMove->GrindRail || bBackwardsGrind != NewSonicMove->bBackwardsGrind
+		|| HomingTarget != NewSonicMove->HomingTarget || HomingPhase != NewSonicMove->HomingPhase)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_Sonic::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(C->GetCharacterMovement());
+	if (!SonicMovement)
+	{
+		return;
+	}
+
+	bWantsRailJump = SonicMovement->bWantsRailJump;
+	bWantsHoming = SonicMovement->bWantsHoming;
+	RequestedHomingTarget = SonicMovement->RequestedHomingTarget;
+
+	GrindRail = SonicMovement->IsGrinding() ? SonicMovement->GetGrindRail() : nullptr;
+	RailDistance = SonicMovement->GetRailDistance();
+	bBackwardsGrind = SonicMovement->IsBackwardsGrind();
+	HomingTarget = SonicMovement->HomingTarget;
+	HomingPhase = SonicMovement->GetHomingPhase();
+}
+
+void FSavedMove_Sonic::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	// The request flags come back through UpdateFromCompressedFlags
+	if (USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(C->GetCharacterMovement()))
+	{
+		SonicMovement->RequestedHomingTarget = RequestedHomingTarget;
+		SonicMovement->FollowMoveGrindState(GrindRail.Get(), RailDistance, bBackwardsGrind);
+	}
+}
+
+FNetworkPredictionData_Client_Sonic::FNetworkPredictionData_Client_Sonic(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Sonic::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Sonic());
+}
+
+void FSonicNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+
+	const FSavedMove_Sonic& SonicMove = static_cast<const FSavedMove_Sonic&>(ClientMove);
+
+	RequestedHomingTarget = SonicMove.bWantsHoming ? SonicMove.RequestedHomingTarget.Get() : nullptr;
+	GrindRail = SonicMove.GrindRail.Get();
+	RailDistance = SonicMove.RailDistance;
+	bBackwardsGrind = SonicMove.bBackwardsGrind;
+}
+
+bool FSonicNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+
+	// Only homing moves have a target to send, an air dash sends the flag alone
+	if ((CompressedMoveFlags & FSavedMove_Sonic::FLAG_Homing) != 0)
+	{
+		SonicMovementReplication::SerializeObject(Ar, RequestedHomingTarget);
+	}
+	else
+	{
+		RequestedHomingTarget = nullptr;
+	}
+
+	SonicMovementReplication::SerializeGrindState(Ar, GrindRail, RailDistance, bBackwardsGrind);
+
+	return !Ar.IsError();
+}
+
+FSonicNetworkMoveDataContainer::FSonicNetworkMoveDataContainer()
+{
+	NewMoveData = &SonicMoveData[0];
+	PendingMoveData = &SonicMoveData[1];
+	OldMoveData = &SonicMoveData[2];
+}
+
+void FSonicMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const USonicMovementComponent& SonicMovement = static_cast<const USonicMovementComponent&>(CharacterMovement);
+
+	GrindRail = SonicMovement.IsGrinding() ? SonicMovement.GetGrindRail() : nullptr;
+	RailDistance = SonicMovement.GetRailDistance();
+	bBackwardsGrind = SonicMovement.IsBackwardsGrind();
+	HomingTarget = SonicMovement.GetHomingTarget();
+	HomingPhase = SonicMovement.GetHomingPhase();
+}
+
+bool FSonicMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	// Good moves are acked without any state
+	if (IsCorrection())
+	{
+		SonicMovementReplication::SerializeGrindState(Ar, GrindRail, RailDistance, bBackwardsGrind);
+		SonicMovementReplication::SerializeObject(Ar, HomingTarget);
+
+		uint8 Phase = (uint8)HomingPhase;
+		Ar.SerializeBits(&Phase, 2);
+		HomingPhase = (ESonicHomingPhase)Phase;
+	}
+
+	return !Ar.IsError();
+}
+
+bool FSonicRepRailMovement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Branch on the bit rather than the rail, which loads as null when its GUID doesn't resolve on this client
+	bool bHasRail = Rail != nullptr;
+	SonicMovementReplication::SerializeBool(Ar, bHasRail);
+
+	if (!bHasRail)
+	{
+		Rail = nullptr;
+		bOutSuccess = !Ar.IsError();
+		return true;
+	}
+
+	AGrindRail* RailObject = Rail;
+	SonicMovementReplication::SerializeObject(Ar, RailObject);
+	Rail = RailObject;
+
+	// Always read what was written so the rest of the bunch lines up, an unresolved rail just ignores it
+	uint32 QuantizedSpeed = (uint32)FMath::RoundToInt(FMath::Max(Speed, 0.0f));
+	SonicMovementReplication::SerializeRailDistance(Ar, Distance);
+	Ar.SerializeIntPacked(QuantizedSpeed);
+	SonicMovementReplication::SerializeBool(Ar, bBackwards);
+
+	if (Ar.IsLoading())
+	{
+		Speed = (float)QuantizedSpeed;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
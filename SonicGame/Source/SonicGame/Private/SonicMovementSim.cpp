@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicMovementSim.h"
+
+namespace SonicMovementSim
+{
+	// Same values as UCharacterMovementComponent
+	static constexpr float MinTickTime = 1e-6f;
+	static constexpr float BrakeToStopVelocity = 10.0f;
+
+	void CalcVelocity(const FVelocityParams& Params, FVector& Velocity)
+	{
+		const float DeltaTime = Params.DeltaTime;
+		const float Friction = FMath::Max(0.0f, Params.Friction);
+		const bool bZeroAcceleration = Params.Acceleration.IsZero();
+
+		// Only apply braking if there is no acceleration
+		if (bZeroAcceleration && Params.bZeroRequestedAcceleration)
+		{
+			const float ActualBrakingFriction = Params.bUseSeparateBrakingFriction ? Params.BrakingFriction : Friction;
+			ApplyVelocityBraking(DeltaTime, ActualBrakingFriction, Params.BrakingFrictionFactor, Params.BrakingDeceleration, Params.BrakingSubStepTime, Velocity);
+		}
+		else if (!bZeroAcceleration)
+		{
+			// Friction affects our ability to change direction. This is only done for input acceleration, not path following.
+			const FVector AccelDir = Params.Acceleration.GetSafeNormal();
+			const float VelSize = Velocity.Size();
+			Velocity = Velocity - (Velocity - AccelDir * VelSize) * FMath::Min(DeltaTime * Friction, 1.f);
+		}
+
+		// Apply fluid friction
+		if (Params.bFluid)
+		{
+			Velocity = Velocity * (1.f - FMath::Min(Friction * DeltaTime, 1.f));
+		}
+
+		// Apply acceleration, allowing 1% over max speed for numeric imprecision like IsExceedingMaxSpeed
+		const float MaxSpeed = FMath::Max(0.0f, Params.MaxSpeed);
+		const bool bExceedingMaxSpeed = Velocity.SizeSquared() > FMath::Square(MaxSpeed) * 1.01f;
+		const float NewMaxSpeed = bExceedingMaxSpeed ? Velocity.Size() : MaxSpeed;
+		Velocity += Params.Acceleration * DeltaTime;
+		Velocity += Params.RequestedAcceleration * DeltaTime;
+		Velocity = Velocity.GetClampedToMaxSize(NewMaxSpeed);
+	}
+
+	void ApplyVelocityBraking(float DeltaTime, float Friction, float BrakingFrictionFactor, float BrakingDeceleration, float BrakingSubStepTime, FVector& Velocity)
+	{
+		if (Velocity.IsZero() || DeltaTime < MinTickTime)
+		{
+			return;
+		}
+
+		Friction = FMath::Max(0.0f, Friction * FMath::Max(0.0f, BrakingFrictionFactor));
+		BrakingDeceleration = FMath::Max(0.0f, BrakingDeceleration);
+		const bool bZeroFriction = Friction == 0.0f;
+		const bool bZeroBraking = BrakingDeceleration == 0.0f;
+
+		if (bZeroFriction && bZeroBraking)
+		{
+			return;
+		}
+
+		const FVector OldVel = Velocity;
+
+		// Subdivide braking to get reasonably consistent results at lower frame rates
+		float RemainingTime = DeltaTime;
+		const float MaxTimeStep = FMath::Clamp(BrakingSubStepTime, 1.0f / 75.0f, 1.0f / 20.0f);
+
+		// Decelerate to brake to a stop
+		const FVector RevAccel = bZeroBraking ? FVector::ZeroVector : -BrakingDeceleration * Velocity.GetSafeNormal();
+		while (RemainingTime >= MinTickTime)
+		{
+			// Zero friction uses constant deceleration, so no need for iteration
+			const float dt = (RemainingTime > MaxTimeStep && !bZeroFriction) ? FMath::Min(MaxTimeStep, RemainingTime * 0.5f) : RemainingTime;
+			RemainingTime -= dt;
+
+			Velocity = Velocity + (-Friction * Velocity + RevAccel) * dt;
+
+			// Don't reverse direction
+			if ((Velocity | OldVel) <= 0.0f)
+			{
+				Velocity = FVector::ZeroVector;
+				return;
+			}
+		}
+
+		// Clamp to zero if nearly zero, or if below min threshold and braking
+		const float VSizeSq = Velocity.SizeSquared();
+		if (VSizeSq <= KINDA_SMALL_NUMBER || (!bZeroBraking && VSizeSq <= FMath::Square(BrakeToStopVelocity)))
+		{
+			Velocity = FVector::ZeroVector;
+		}
+	}
+
+	void StepRail(const FRailSample& Sample, const FRailParams& Params, FRailState& State)
+	{
+		const FQuat PreviousRotation = State.Rotation.Quaternion();
+		const FVector PreviousForward = PreviousRotation.GetForwardVector();
+		const FVector PreviousUp = PreviousRotation.GetUpVector();
+
+		// Calculate rail velocity, pointing the way the grinder travels
+		FVector RailVelocity = Sample.Tangent.GetSafeNormal() * State.Velocity.Length();
+		const FVector OriginalRailVelocity = RailVelocity;
+		RailVelocity = (State.bBackwards ? -RailVelocity : RailVelocity).GetClampedToSize(0.0f, Params.MaxRailSpeed);
+
+		// Add friction based on angle of the rail, slowing the grinder down uphill and speeding it up downhill
+		RailVelocity -= (PreviousForward * Params.RailAccelerationMultiplier * Params.DeltaTime) * State.Rotation.Pitch;
+		if (RailVelocity.Length() < 1.0f)
+		{
+			State.bBackwards = !State.bBackwards;
+		}
+
+		State.Velocity = RailVelocity;
+
+		// Place the grinder on the rail, facing the way it is grinding
+		State.Location = Sample.Location + PreviousUp * Params.RailOffset;
+		State.Rotation = FRotationMatrix::MakeFromXZ(State.bBackwards ? -OriginalRailVelocity : OriginalRailVelocity, Sample.Up).Rotator();
+		State.Rotation.Roll = Sample.Roll;
+
+		const float RailDelta = GetRailDistanceRate((float)RailVelocity.Length(), State.Rotation.Vector()) * Params.DeltaTime;
+
+		State.Distance += State.bBackwards ? -RailDelta : RailDelta;
+	}
+
+	float GetRailDistanceRate(float Speed, const FVector& Forward)
+	{
+		// The velocity was just replaced, so last frame's and this frame's deltas are the same
+		const float ZRange = FMath::GetMappedRangeValueClamped(FVector2f(-1.0f, 1.0f), FVector2f(1.15f, 0.55f), (float)Forward.Z);
+
+		return (Speed + Speed) * ZRange;
+	}
+
+	FVector GetRailJumpVelocity(const FVector& RailVelocity, const FVector& RailUp, const FRailParams& Params)
+	{
+		// StepRail's velocity already points the way the grinder travels, so it carries straight on
+		return FVector(RailVelocity.X, RailVelocity.Y, RailUp.Z * Params.RailJumpHeight);
+	}
+
+	ERailEndResult ResolveRailEnd(float RailLength, bool bClosedLoop, FRailState& State)
+	{
+		if (State.Distance <= RailLength && State.Distance > 0.0f)
+		{
+			return ERailEndResult::OnRail;
+		}
+
+		if (bClosedLoop)
+		{
+			// Circle back to the other end
+			State.Distance = State.bBackwards ? RailLength : 0.0f;
+			return ERailEndResult::Wrapped;
+		}
+
+		return ERailEndResult::Exited;
+	}
+
+	FVector MoveTowards(const FVector& Current, const FVector& Target, float MaxDistanceDelta)
+	{
+		const FVector ToTarget = Target - Current;
+		const float Magnitude = ToTarget.Length();
+		if (Magnitude <= MaxDistanceDelta || Magnitude == 0.0f)
+		{
+			return Target;
+		}
+
+		return Current + ToTarget / Magnitude * MaxDistanceDelta;
+	}
+}
@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicPerfTracker.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "SonicGame.h"
+#include "Algo/BinarySearch.h"
+#include "Debug/DebugDrawService.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+static TAutoConsoleVariable<float> CVarSonicPerfBudgetRailDetection(
+	TEXT("sonic.perf.Budget.RailDetection"),
+	0.1f,
+	TEXT("Frame budget in milliseconds for rail and side rail detection, shown by sonic.perf."));
+
+static TAutoConsoleVariable<float> CVarSonicPerfBudgetGrinding(
+	TEXT("sonic.perf.Budget.Grinding"),
+	0.1f,
+	TEXT("Frame budget in milliseconds for moving along grind rails, shown by sonic.perf."));
+
+static TAutoConsoleVariable<float> CVarSonicPerfBudgetHoming(
+	TEXT("sonic.perf.Budget.Homing"),
+	0.1f,
+	TEXT("Frame budget in milliseconds for the homing target search and attack, shown by sonic.perf."));
+
+static TAutoConsoleVariable<float> CVarSonicPerfBudgetProjectionSpawning(
+	TEXT("sonic.perf.Budget.ProjectionSpawning"),
+	0.25f,
+	TEXT("Frame budget in milliseconds for spawning and updating projections, shown by sonic.perf."));
+
+static FAutoConsoleCommand CmdSonicPerf(
+	TEXT("sonic.perf"),
+	TEXT("Toggles the gameplay frame budget overlay. Usage: sonic.perf [dump|reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FSonicPerfTracker& Tracker = FSonicPerfTracker::Get();
+
+		if (Args.Num() == 0)
+		{
+			Tracker.SetEnabled(!Tracker.IsEnabled());
+		}
+		else if (Args[0] == TEXT("dump"))
+		{
+			if (!Tracker.IsEnabled())
+			{
+				UE_LOG(LogSonicGame, Display, TEXT("sonic.perf is off, turn it on and play for a while before dumping."));
+				return;
+			}
+			Tracker.Dump();
+		}
+		else if (Args[0] == TEXT("reset"))
+		{
+			Tracker.Reset();
+		}
+	}));
+
+/** Innermost running perf scope, so nested scopes can pause it. */
+static FSonicPerfScope* CurrentPerfScope = nullptr;
+
+FSonicPerfTracker& FSonicPerfTracker::Get()
+{
+	static FSonicPerfTracker Tracker;
+	return Tracker;
+}
+
+void FSonicPerfTracker::SetEnabled(bool bInEnabled)
+{
+	if (bEnabled == bInEnabled)
+	{
+		return;
+	}
+
+	bEnabled = bInEnabled;
+
+	if (bEnabled)
+	{
+		Reset();
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FSonicPerfTracker::OnEndFrame);
+		DrawHandle = UDebugDrawService::Register(TEXT("Game"), FDebugDrawDelegate::CreateRaw(this, &FSonicPerfTracker::Draw));
+	}
+	else
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		UDebugDrawService::Unregister(DrawHandle);
+	}
+}
+
+void FSonicPerfTracker::Reset()
+{
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		History[i].Init(0.0f, HistoryLength);
+		FrameCycles[i] = 0;
+	}
+
+	HistoryHead = 0;
+	HistoryNum = 0;
+	OverlayLines.Reset();
+	LastOverlayUpdateTime = 0.0;
+}
+
+FSonicPerfTracker::FCategoryStats FSonicPerfTracker::GetStats(ESonicPerfCategory Category) const
+{
+	FCategoryStats Stats;
+	Stats.BudgetMs = GetBudgetMs(Category);
+	Stats.NumFrames = HistoryNum;
+
+	if (HistoryNum == 0)
+	{
+		return Stats;
+	}
+
+	// Until the history has filled up it starts at index 0
+	SortedTimes.Reset();
+	SortedTimes.Append(History[(int32)Category].GetData(), HistoryNum);
+	SortedTimes.Sort();
+
+	auto Percentile = [this](float Fraction)
+	{
+		return SortedTimes[FMath::Clamp(FMath::CeilToInt32(Fraction * SortedTimes.Num()) - 1, 0, SortedTimes.Num() - 1)];
+	};
+
+	Stats.P50Ms = Percentile(0.50f);
+	Stats.P95Ms = Percentile(0.95f);
+	Stats.P99Ms = Percentile(0.99f);
+	Stats.MaxMs = SortedTimes.Last();
+	Stats.NumFramesOverBudget = SortedTimes.Num() - Algo::UpperBound(SortedTimes, Stats.BudgetMs);
+	Stats.bOverBudget = Stats.P95Ms > Stats.BudgetMs;
+
+	return Stats;
+}
+
+void FSonicPerfTracker::Dump() const
+{
+	UE_LOG(LogSonicGame, Display, TEXT("Gameplay frame budgets over the last %d frames:"), HistoryNum);
+
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		const ESonicPerfCategory Category = (ESonicPerfCategory)i;
+		const FCategoryStats Stats = GetStats(Category);
+
+		UE_LOG(LogSonicGame, Display, TEXT("  %-20s p50 %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms  budget %.3f ms  over budget %d frames%s"),
+			GetCategoryName(Category), Stats.P50Ms, Stats.P95Ms, Stats.P99Ms, Stats.MaxMs, Stats.BudgetMs, Stats.NumFramesOverBudget,
+			Stats.bOverBudget ? TEXT("  OVER BUDGET") : TEXT(""));
+	}
+}
+
+const TCHAR* FSonicPerfTracker::GetCategoryName(ESonicPerfCategory Category)
+{
+	switch (Category)
+	{
+	case ESonicPerfCategory::RailDetection:
+		return TEXT("Rail Detection");
+	case ESonicPerfCategory::Grinding:
+		return TEXT("Grinding");
+	case ESonicPerfCategory::Homing:
+		return TEXT("Homing");
+	case ESonicPerfCategory::ProjectionSpawning:
+		return TEXT("Projection Spawning");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+float FSonicPerfTracker::GetBudgetMs(ESonicPerfCategory Category)
+{
+	switch (Category)
+	{
+	case ESonicPerfCategory::RailDetection:
+		return CVarSonicPerfBudgetRailDetection.GetValueOnGameThread();
+	case ESonicPerfCategory::Grinding:
+		return CVarSonicPerfBudgetGrinding.GetValueOnGameThread();
+	case ESonicPerfCategory::Homing:
+		return CVarSonicPerfBudgetHoming.GetValueOnGameThread();
+	case ESonicPerfCategory::ProjectionSpawning:
+		return CVarSonicPerfBudgetProjectionSpawning.GetValueOnGameThread();
+	default:
+		return 0.0f;
+	}
+}
+
+void FSonicPerfTracker::OnEndFrame()
+{
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		History[i][HistoryHead] = (float)FPlatformTime::ToMilliseconds64(FrameCycles[i]);
+		FrameCycles[i] = 0;
+	}
+
+	HistoryHead = (HistoryHead + 1) % HistoryLength;
+	HistoryNum = FMath::Min(HistoryNum + 1, HistoryLength);
+}
+
+void FSonicPerfTracker::Draw(UCanvas* Canvas, APlayerController* PlayerController)
+{
+	if (!Canvas || !GEngine)
+	{
+		return;
+	}
+
+	// Sorting every category's history is the only real cost, so only do it a few times a second
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastOverlayUpdateTime > 0.25)
+	{
+		LastOverlayUpdateTime = Now;
+		UpdateOverlayLines();
+	}
+
+	UFont* Font = GEngine->GetSmallFont();
+	const float LineHeight = Font->GetMaxCharHeight() + 2.0f;
+	float Y = Canvas->ClipY * 0.2f;
+
+	for (const TPair<FString, FColor>& Line : OverlayLines)
+	{
+		Canvas->SetDrawColor(Line.Value);
+		Canvas->DrawText(Font, Line.Key, 20.0f, Y);
+		Y += LineHeight;
+	}
+}
+
+void FSonicPerfTracker::UpdateOverlayLines()
+{
+	OverlayLines.Reset();
+	OverlayLines.Emplace(FString::Printf(TEXT("Gameplay budgets (ms, %d frames)     p50     p95     p99  budget"), HistoryNum), FColor::White);
+
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		const ESonicPerfCategory Category = (ESonicPerfCategory)i;
+		const FCategoryStats Stats = GetStats(Category);
+
+		const FColor Color = Stats.bOverBudget ? FColor::Red : (Stats.NumFramesOverBudget > 0 ? FColor::Yellow : FColor::Green);
+		OverlayLines.Emplace(FString::Printf(TEXT("%-30s %7.3f %7.3f %7.3f %7.3f%s"),
+			GetCategoryName(Category), Stats.P50Ms, Stats.P95Ms, Stats.P99Ms, Stats.BudgetMs,
+			Stats.bOverBudget ? TEXT("  OVER") : TEXT("")), Color);
+	}
+}
+
+FSonicPerfScope::FSonicPerfScope(ESonicPerfCategory InCategory)
+	: Category(InCategory)
+{
+	if (!FSonicPerfTracker::Get().IsEnabled() || !IsInGameThread())
+	{
+		return;
+	}
+
+	bActive = true;
+	StartCycles = FPlatformTime::Cycles64();
+
+	// Time spent in here belongs to this category, not the enclosing one
+	Parent = CurrentPerfScope;
+	if (Parent)
+	{
+		FSonicPerfTracker::Get().AddTime(Parent->Category, StartCycles - Parent->StartCycles);
+	}
+
+	CurrentPerfScope = this;
+}
+
+FSonicPerfScope::~FSonicPerfScope()
+{
+	if (!bActive)
+	{
+		return;
+	}
+
+	const uint64 EndCycles = FPlatformTime::Cycles64();
+	FSonicPerfTracker::Get().AddTime(Category, EndCycles - StartCycles);
+
+	CurrentPerfScope = Parent;
+	if (Parent)
+	{
+		Parent->StartCycles = EndCycles;
+	}
+}
+
+#endif
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicSignificanceSubsystem.h"
+#include "SonicGame.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SonicSignificanceUpdate, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance High"), STAT_SonicSignificanceHigh, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Medium"), STAT_SonicSignificanceMedium, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Low"), STAT_SonicSignificanceLow, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Dormant"), STAT_SonicSignificanceDormant, STATGROUP_SonicGame);
+
+static TAutoConsoleVariable<int32> CVarSonicSignificanceHighCount(
+	TEXT("sonic.Significance.HighCount"),
+	8,
+	TEXT("Most actors animating at full rate."));
+
+static TAutoConsoleVariable<int32> CVarSonicSignificanceMediumCount(
+	TEXT("sonic.Significance.MediumCount"),
+	24,
+	TEXT("Most actors animating at a reduced rate, after the full rate ones."));
+
+static TAutoConsoleVariable<float> CVarSonicSignificanceHighDistance(
+	TEXT("sonic.Significance.HighDistance"),
+	3000.0f,
+	TEXT("Actors further than this from the view never animate at full rate."));
+
+static TAutoConsoleVariable<float> CVarSonicSignificanceMediumDistance(
+	TEXT("sonic.Significance.MediumDistance"),
+	8000.0f,
+	TEXT("Actors further than this from the view animate at a low rate and only while rendered."));
+
+static TAutoConsoleVariable<float> CVarSonicSignificanceDormantDistance(
+	TEXT("sonic.Significance.DormantDistance"),
+	20000.0f,
+	TEXT("Actors further than this from the view have their meshes deactivated."));
+
+static TAutoConsoleVariable<float> CVarSonicSignificanceOffscreenScale(
+	TEXT("sonic.Significance.OffscreenScale"),
+	2.5f,
+	TEXT("Distance multiplier for actors outside the view cone when ranking them."));
+
+static TAutoConsoleVariable<float> CVarSonicSignificanceUpdatePeriod(
+	TEXT("sonic.Significance.UpdatePeriod"),
+	0.1f,
+	TEXT("Seconds between significance updates."));
+
+namespace SonicSignificance
+{
+	/** Cosine of the half angle of the cone counted as in view, a little wider than the camera so turning doesn't pop. */
+	static constexpr float ViewConeCos = 0.4f;
+
+	struct FBucketSettings
+	{
+		/** Tick interval of the actor and its meshes, never lower than what they had before they were managed. */
+		float TickInterval;
+
+		/** Only update the pose while a mesh is rendered. */
+		bool bOnlyTickPoseWhenRendered;
+
+		bool bMeshesActive;
+	};
+
+	/** Indexed by ESonicSignificance. */
+	static const FBucketSettings BucketSettings[] =
+	{
+		{ 0.0f, false, true },
+		{ 1.0f / 30.0f, false, true },
+		{ 0.1f, true, true },
+		{ 0.5f, true, false },
+	};
+}
+
+void USonicSignificanceSubsystem::RegisterActor(AActor* Actor)
+{
+	if (Actors.Add(Actor) == INDEX_NONE)
+	{
+		return;
+	}
+
+	FSignificanceEntry Entry;
+	Entry.ActorTickInterval = Actor->GetActorTickInterval();
+
+	TInlineComponentArray<USkeletalMeshComponent*> Meshes(Actor);
+	for (USkeletalMeshComponent* Mesh : Meshes)
+	{
+		FManagedMesh& ManagedMesh = Entry.Meshes.AddDefaulted_GetRef();
+		ManagedMesh.Mesh = Mesh;
+		ManagedMesh.TickInterval = Mesh->GetComponentTickInterval();
+		ManagedMesh.VisibilityBasedAnimTickOption = Mesh->VisibilityBasedAnimTickOption;
+		ManagedMesh.bWasActive = Mesh->IsActive();
+	}
+
+	Entries.Add(MoveTemp(Entry));
+}
+
+void USonicSignificanceSubsystem::UnregisterActor(AActor* Actor)
+{
+	const int32 EntryIndex = Actors.Find(Actor);
+	if (EntryIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	ApplySignificance(EntryIndex, ESonicSignificance::High);
+	Actors.RemoveAtSwap(EntryIndex, Entries);
+}
+
+ESonicSignificance USonicSignificanceSubsystem::GetSignificance(const AActor* Actor) const
+{
+	const int32 EntryIndex = Actors.Find(Actor);
+	return EntryIndex != INDEX_NONE ? Entries[EntryIndex].Significance : ESonicSignificance::High;
+}
+
+void USonicSignificanceSubsystem::UpdateSignificance(const FVector& ViewLocation, const FVector& ViewDirection)
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicSignificanceUpdate);
+
+	const float OffscreenScale = CVarSonicSignificanceOffscreenScale.GetValueOnGameThread();
+
+	RankedEntries.Reset(Entries.Num());
+
+	for (int32 EntryIndex = Entries.Num() - 1; EntryIndex >= 0; EntryIndex--)
+	{
+		const AActor* Actor = Actors.Get(EntryIndex);
+		if (!IsValid(Actor))
+		{
+			Actors.RemoveAtSwap(EntryIndex, Entries);
+			continue;
+		}
+
+		const FVector ToActor = Actor->GetActorLocation() - ViewLocation;
+		const float Distance = ToActor.Size();
+		const bool bInView = FVector::DotProduct(ToActor, ViewDirection) >= Distance * SonicSignificance::ViewConeCos;
+
+		Entries[EntryIndex].Score = bInView ? Distance : Distance * OffscreenScale;
+	}
+
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		RankedEntries.Add(EntryIndex);
+	}
+
+	RankedEntries.Sort([this](int32 A, int32 B)
+		{
+			return Entries[A].Score < Entries[B].Score;
+		});
+
+	const int32 HighCount = CVarSonicSignificanceHighCount.GetValueOnGameThread();
+	const int32 MediumCount = HighCount + CVarSonicSignificanceMediumCount.GetValueOnGameThread();
+	const float HighDistance = CVarSonicSignificanceHighDistance.GetValueOnGameThread();
+	const float MediumDistance = CVarSonicSignificanceMediumDistance.GetValueOnGameThread();
+	const float DormantDistance = CVarSonicSignificanceDormantDistance.GetValueOnGameThread();
+
+	int32 NumInBucket[4] = {};
+
+	for (int32 Rank = 0; Rank < RankedEntries.Num(); Rank++)
+	{
+		const int32 EntryIndex = RankedEntries[Rank];
+		const FSignificanceEntry& Entry = Entries[EntryIndex];
+
+		ESonicSignificance Significance = ESonicSignificance::Dormant;
+		if (Rank < HighCount && Entry.Score <= HighDistance)
+		{
+			Significance = ESonicSignificance::High;
+		}
+		else if (Rank < MediumCount && Entry.Score <= MediumDistance)
+		{
+			Significance = ESonicSignificance::Medium;
+		}
+		else if (Entry.Score <= DormantDistance)
+		{
+			Significance = ESonicSignificance::Low;
+		}
+
+		if (Significance != Entry.Significance)
+		{
+			ApplySignificance(EntryIndex, Significance);
+		}
+
+		NumInBucket[(int32)Significance]++;
+	}
+
+	SET_DWORD_STAT(STAT_SonicSignificanceHigh, NumInBucket[(int32)ESonicSignificance::High]);
+	SET_DWORD_STAT(STAT_SonicSignificanceMedium, NumInBucket[(int32)ESonicSignificance::Medium]);
+	SET_DWORD_STAT(STAT_SonicSignificanceLow, NumInBucket[(int32)ESonicSignificance::Low]);
+	SET_DWORD_STAT(STAT_SonicSignificanceDormant, NumInBucket[(int32)ESonicSignificance::Dormant]);
+}
+
+void USonicSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < CVarSonicSignificanceUpdatePeriod.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	// Without a view there is nothing to rank against, keep the buckets as they are
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!PlayerController)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	TimeSinceUpdate = 0.0f;
+	UpdateSignificance(ViewLocation, ViewRotation.Vector());
+}
+
+TStatId USonicSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USonicSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void USonicSignificanceSubsystem::Deinitialize()
+{
+	Actors.Empty();
+	Entries.Empty();
+	RankedEntries.Empty();
+
+	Super::Deinitialize();
+}
+
+void USonicSignificanceSubsystem::ApplySignificance(int32 EntryIndex, ESonicSignificance Significance)
+{
+	FSignificanceEntry& Entry = Entries[EntryIndex];
+	Entry.Significance = Significance;
+
+	const SonicSignificance::FBucketSettings& Settings = SonicSignificance::BucketSettings[(int32)Significance];
+
+	if (AActor* Actor = Actors.Get(EntryIndex))
+	{
+		Actor->SetActorTickInterval(FMath::Max(Entry.ActorTickInterval, Settings.TickInterval));
+	}
+
+	for (const FManagedMesh& ManagedMesh : Entry.Meshes)
+	{
+		USkeletalMeshComponent* Mesh = ManagedMesh.Mesh.Get();
+		if (!Mesh)
+		{
+			continue;
+		}
+
+		Mesh->SetComponentTickInterval(FMath::Max(ManagedMesh.TickInterval, Settings.TickInterval));
+		Mesh->VisibilityBasedAnimTickOption = Settings.bOnlyTickPoseWhenRendered ? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered : ManagedMesh.VisibilityBasedAnimTickOption;
+
+		// Deactivating stops the mesh ticking, it keeps drawing its last pose
+		const bool bActive = ManagedMesh.bWasActive && Settings.bMeshesActive;
+		if (Mesh->IsActive() != bActive)
+		{
+			Mesh->SetActive(bActive);
+		}
+	}
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicSpringArmComponent.h"
+#include "SonicGame.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Camera Probe"), STAT_SonicCameraProbe, STATGROUP_SonicGame);
+
+void USonicSpringArmComponent::UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime)
+{
+	// Lets the base arm place the socket at full length, collision is applied on top from the async sweeps
+	Super::UpdateDesiredArmLocation(false, bDoLocationLag, bDoRotationLag, DeltaTime);
+
+	if (!bDoTrace || TargetArmLength == 0.0f)
+	{
+		ProbedArmFraction = 1.0f;
+		ArmFraction = 1.0f;
+		return;
+	}
+
+	// Where the base arm put the origin and the unobstructed camera this frame
+	const FVector ArmOrigin = PreviousArmOrigin;
+	const FVector DesiredLocation = UnfixedCameraPosition;
+
+	IssueProbe(ArmOrigin, DesiredLocation, DeltaTime);
+
+	// Pull in quickly so geometry doesn't get between the camera and the character, ease back out
+	const float HalfLife = ProbedArmFraction < ArmFraction ? PullInHalfLife : PushOutHalfLife;
+	const float Alpha = 1.0f - FMath::Exp2(-DeltaTime / FMath::Max(HalfLife, 0.001f));
+	ArmFraction = FMath::Lerp(ArmFraction, ProbedArmFraction, Alpha);
+
+	if (ArmFraction >= 1.0f - KINDA_SMALL_NUMBER)
+	{
+		ArmFraction = 1.0f;
+		return;
+	}
+
+	const FVector ResultLocation = FMath::Lerp(ArmOrigin, DesiredLocation, ArmFraction);
+
+	bIsCameraFixed = true;
+	RelativeSocketLocation = GetComponentTransform().InverseTransformPosition(ResultLocation);
+
+	UpdateChildTransforms();
+}
+
+void USonicSpringArmComponent::IssueProbe(const FVector& ArmOrigin, const FVector& DesiredLocation, float DeltaTime)
+{
+	TimeSinceProbe += DeltaTime;
+
+	UWorld* World = GetWorld();
+	if (!World || PendingProbe.IsValid())
+	{
+		return;
+	}
+
+	const FVector Velocity = GetOwner() ? GetOwner()->GetVelocity() : FVector::ZeroVector;
+	const float Speed = Velocity.Size();
+
+	const float ProbeRate = FMath::GetMappedRangeValueClamped(FVector2f(0.0f, ProbeRateMaxSpeed), FVector2f(ProbeRateAtRest, ProbeRateAtMaxSpeed), Speed);
+	const float ProbeInterval = 1.0f / FMath::Max(ProbeRate, 1.0f);
+	if (TimeSinceProbe < ProbeInterval)
+	{
+		return;
+	}
+
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicCameraProbe);
+
+	// The result lands next frame and is used until the one after it lands, sweep where the arm will be by then
+	const FVector Lead = Velocity * (DeltaTime + ProbeInterval);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SonicSpringArm), false, GetOwner());
+
+	if (!ProbeDelegate.IsBound())
+	{
+		ProbeDelegate.BindUObject(this, &USonicSpringArmComponent::OnProbeCompleted);
+	}
+
+	INC_DWORD_STAT(STAT_SonicTracesIssued);
+
+	PendingProbe = World->AsyncSweepByChannel(EAsyncTraceType::Single, ArmOrigin + Lead, DesiredLocation + Lead, FQuat::Identity, ProbeChannel,
+		FCollisionShape::MakeSphere(ProbeSize), QueryParams, FCollisionResponseParams::DefaultResponseParam, &ProbeDelegate);
+	TimeSinceProbe = 0.0f;
+}
+
+void USonicSpringArmComponent::OnProbeCompleted(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	if (Handle != PendingProbe)
+	{
+		return;
+	}
+
+	PendingProbe.Invalidate();
+
+	// Both ends were moved by the same lead, so the hit time is a fraction of the arm wherever it is now
+	const FHitResult* Hit = FHitResult::GetFirstBlockingHit(Datum.OutHits);
+	ProbedArmFraction = Hit ? Hit->Time : 1.0f;
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicTickManagerSubsystem.h"
+#include "SonicGame.h"
+#include "SonicBatchTickable.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batch Tick"), STAT_SonicBatchTick, STATGROUP_SonicGame);
+
+void USonicTickManagerSubsystem::RegisterActor(AActor* Actor)
+{
+	if (Actors.Add(Actor) == INDEX_NONE)
+	{
+		return;
+	}
+
+	BatchTickables.Add(Cast<ISonicBatchTickable>(Actor));
+	DistancesToPlayer.Add(TNumericLimits<float>::Max());
+}
+
+void USonicTickManagerSubsystem::UnregisterActor(AActor* Actor)
+{
+	const int32 EntryIndex = Actors.Find(Actor);
+	if (EntryIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Actors can be destroyed from inside a batch tick, leave the hole for the next tick to clean up
+	if (bIsBatchTicking)
+	{
+		Actors.ResetAt(EntryIndex);
+		BatchTickables[EntryIndex] = nullptr;
+	}
+	else
+	{
+		Actors.RemoveAtSwap(EntryIndex, BatchTickables, DistancesToPlayer);
+	}
+}
+
+void USonicTickManagerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicBatchTick);
+
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	const FVector PlayerLocation = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+
+	int32 NumTicksAvoided = 0;
+
+	for (int32 EntryIndex = Actors.Num() - 1; EntryIndex >= 0; EntryIndex--)
+	{
+		const AActor* Actor = Actors.Get(EntryIndex);
+		if (!IsValid(Actor))
+		{
+			Actors.RemoveAtSwap(EntryIndex, BatchTickables, DistancesToPlayer);
+			continue;
+		}
+
+		DistancesToPlayer[EntryIndex] = Player ? FVector::Dist(Actor->GetActorLocation(), PlayerLocation) : TNumericLimits<float>::Max();
+
+		// Blueprint subclasses that implement Event Tick get their tick function back
+		if (!Actor->IsActorTickEnabled())
+		{
+			NumTicksAvoided++;
+		}
+	}
+
+	bIsBatchTicking = true;
+	for (int32 EntryIndex = 0; EntryIndex < Actors.Num(); EntryIndex++)
+	{
+		if (BatchTickables[EntryIndex])
+		{
+			BatchTickables[EntryIndex]->BatchTick(DeltaTime, DistancesToPlayer[EntryIndex]);
+		}
+	}
+	bIsBatchTicking = false;
+
+	SET_DWORD_STAT(STAT_SonicEnemyTicksAvoided, NumTicksAvoided);
+}
+
+TStatId USonicTickManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USonicTickManagerSubsystem, STATGROUP_Tickables);
+}
+
+void USonicTickManagerSubsystem::Deinitialize()
+{
+	Actors.Empty();
+	BatchTickables.Empty();
+	DistancesToPlayer.Empty();
+
+	Super::Deinitialize();
+}
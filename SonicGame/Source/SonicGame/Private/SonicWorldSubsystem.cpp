@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SonicWorldSubsystem.h"
+
+static bool IsGameWorldType(const EWorldType::Type WorldType)
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool USonicWorldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return IsGameWorldType(WorldType);
+}
+
+bool USonicTickableWorldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return IsGameWorldType(WorldType);
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurfaceAlignmentComponent.h"
+#include "SonicGame.h"
+#include "SonicMovementComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Surface Alignment"), STAT_SonicSurfaceAlignment, STATGROUP_SonicGame);
+
+// Sets default values for this component's properties
+USurfaceAlignmentComponent::USurfaceAlignmentComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void USurfaceAlignmentComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	CharacterMovement = GetOwner() ? GetOwner()->FindComponentByClass<UCharacterMovementComponent>() : nullptr;
+}
+
+void USurfaceAlignmentComponent::AlignToSurface(float DeltaTime)
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicSurfaceAlignment);
+
+	if (!CharacterMovement || !CharacterMovement->UpdatedComponent)
+	{
+		return;
+	}
+
+	if (!CharacterMovement->IsMovingOnGround() && !CharacterMovement->IsFalling())
+	{
+		return;
+	}
+
+	USceneComponent* UpdatedComponent = CharacterMovement->UpdatedComponent;
+	const FQuat CurrentRotation = UpdatedComponent->GetComponentQuat();
+	const FQuat TargetRotation = GetTargetRotation();
+
+	// The dot product of two quaternions is the cosine of half the angle between them
+	const float CosHalfTolerance = FMath::Cos(FMath::DegreesToRadians(AlignmentTolerance) * 0.5f);
+	if (FMath::Abs(CurrentRotation | TargetRotation) >= CosHalfTolerance)
+	{
+		return;
+	}
+
+	const float Alpha = 1.0f - FMath::Exp2(-DeltaTime / FMath::Max(AlignmentHalfLife, 0.001f));
+	UpdatedComponent->SetWorldRotation(FQuat::Slerp(CurrentRotation, TargetRotation, Alpha));
+}
+
+FQuat USurfaceAlignmentComponent::GetTargetRotation() const
+{
+	if (!CharacterMovement || !CharacterMovement->UpdatedComponent)
+	{
+		return FQuat::Identity;
+	}
+
+	const FQuat CurrentRotation = CharacterMovement->UpdatedComponent->GetComponentQuat();
+
+	const bool bOnFloor = CharacterMovement->IsMovingOnGround() && CharacterMovement->CurrentFloor.IsWalkableFloor();
+	FVector TargetUp = bOnFloor ? CharacterMovement->CurrentFloor.HitResult.ImpactNormal : FVector::UpVector;
+
+	FSonicFloorSample FloorAhead;
+	const USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(CharacterMovement);
+	if (bOnFloor && SonicMovement && SonicMovement->GetPredictedFloor(SonicMovement->Velocity.Size() * FloorLeadTime, FloorAhead))
+	{
+		TargetUp = FloorAhead.Normal;
+	}
+
+	// Shortest turn that stands the up axis on the target, which keeps the heading
+	FQuat TargetRotation = FQuat::FindBetweenNormals(CurrentRotation.GetUpVector(), TargetUp) * CurrentRotation;
+
+	if (bOnFloor && bFaceVelocity)
+	{
+		const FVector Facing = FVector::VectorPlaneProject(CharacterMovement->Velocity, TargetUp);
+		if (Facing.SizeSquared() > FMath::Square(MinFacingSpeed))
+		{
+			// Both directions lie in the floor plane, so this is a twist about TargetUp.
+			// FindBetweenNormals picks an arbitrary axis for opposite directions, which could tip the character over.
+			const FVector Forward = TargetRotation.GetForwardVector();
+			const FVector Direction = Facing.GetUnsafeNormal();
+			const FQuat Twist = (Forward | Direction) < -0.9999f ? FQuat(TargetUp, PI) : FQuat::FindBetweenNormals(Forward, Direction);
+
+			TargetRotation = Twist * TargetRotation;
+		}
+	}
+
+	return TargetRotation;
+}
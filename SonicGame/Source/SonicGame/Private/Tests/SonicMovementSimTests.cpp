@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "SonicMovementSim.h"
+
+/**
+ * Checks the world-free movement math against numbers worked out from the original character code.
+ * Run headless with: UnrealEditor-Cmd SonicGame -ExecCmds="Automation RunTests SonicGame.Movement;Quit" -nullrhi -unattended
+ */
+namespace SonicMovementSimTests
+{
+	static constexpr float DeltaTime = 0.1f;
+
+	static constexpr float RailAccelerationMultiplier = 10.0f;
+
+	/** A straight rail sample pitched by Pitch degrees, with the grinder already lined up with it. */
+	static void MakeSlope(float Pitch, float Speed, SonicMovementSim::FRailSample& OutSample, SonicMovementSim::FRailState& OutState)
+	{
+		const FRotationMatrix SlopeMatrix(FRotator(Pitch, 0.0f, 0.0f));
+
+		OutSample.Location = FVector::ZeroVector;
+		OutSample.Tangent = SlopeMatrix.GetUnitAxis(EAxis::X);
+		OutSample.Up = SlopeMatrix.GetUnitAxis(EAxis::Z);
+		OutSample.Roll = 0.0f;
+
+		OutState.Distance = 1000.0f;
+		OutState.bBackwards = false;
+		OutState.Velocity = OutSample.Tangent * Speed;
+		OutState.Rotation = FRotator(Pitch, 0.0f, 0.0f);
+	}
+
+	static SonicMovementSim::FRailParams MakeParams()
+	{
+		SonicMovementSim::FRailParams Params;
+		Params.DeltaTime = DeltaTime;
+		Params.MaxRailSpeed = 2000.0f;
+		Params.RailAccelerationMultiplier = RailAccelerationMultiplier;
+		Params.RailOffset = 0.0f;
+		Params.RailJumpHeight = 1000.0f;
+		return Params;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSonicStepRailSlopeTest, "SonicGame.Movement.StepRail.Slopes", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSonicStepRailSlopeTest::RunTest(const FString& Parameters)
+{
+	using namespace SonicMovementSimTests;
+
+	// The old GrindOnRail changed speed by RailAccelerationMultiplier * DeltaTime * Pitch each step, 10 here,
+	// and advanced (previous + new speed) * DeltaTime scaled by 1.15 facing straight down to 0.55 straight up
+	{
+		SonicMovementSim::FRailSample Sample;
+		SonicMovementSim::FRailState State;
+		MakeSlope(10.0f, 1000.0f, Sample, State);
+
+		SonicMovementSim::StepRail(Sample, MakeParams(), State);
+
+		TestEqual(TEXT("Climbing slows the grinder down"), (float)State.Velocity.Length(), 990.0f, 0.01f);
+		TestTrue(TEXT("Climbing velocity points along the rail"), (State.Velocity | Sample.Tangent) > 0.0f);
+		TestFalse(TEXT("Climbing keeps the direction"), State.bBackwards);
+		TestEqual(TEXT("Climbing distance"), State.Distance, 1000.0f + 157.985f, 0.01f);
+	}
+
+	{
+		SonicMovementSim::FRailSample Sample;
+		SonicMovementSim::FRailState State;
+		MakeSlope(-10.0f, 1000.0f, Sample, State);
+
+		SonicMovementSim::StepRail(Sample, MakeParams(), State);
+
+		TestEqual(TEXT("Descending speeds the grinder up"), (float)State.Velocity.Length(), 1010.0f, 0.01f);
+		TestTrue(TEXT("Descending velocity points along the rail"), (State.Velocity | Sample.Tangent) > 0.0f);
+		TestFalse(TEXT("Descending keeps the direction"), State.bBackwards);
+		TestEqual(TEXT("Descending distance"), State.Distance, 1000.0f + 182.223f, 0.01f);
+	}
+
+	{
+		SonicMovementSim::FRailSample Sample;
+		SonicMovementSim::FRailState State;
+		MakeSlope(10.0f, 1000.0f, Sample, State);
+
+		// Grinding against the spline takes the grinder down the slope
+		State.bBackwards = true;
+		State.Velocity = -Sample.Tangent * 1000.0f;
+		State.Rotation = FRotator(-10.0f, 180.0f, 0.0f);
+
+		SonicMovementSim::StepRail(Sample, MakeParams(), State);
+
+		TestEqual(TEXT("Descending backwards speeds the grinder up"), (float)State.Velocity.Length(), 1010.0f, 0.01f);
+		TestTrue(TEXT("Backwards velocity points against the spline"), (State.Velocity | Sample.Tangent) < 0.0f);
+		TestTrue(TEXT("Backwards distance goes down"), State.Distance < 1000.0f);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSonicStepRailStallTest, "SonicGame.Movement.StepRail.Stall", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSonicStepRailStallTest::RunTest(const FString& Parameters)
+{
+	using namespace SonicMovementSimTests;
+
+	// Climbing at exactly the speed the slope takes away in one step stalls, and the grinder slides back down
+	SonicMovementSim::FRailSample Sample;
+	SonicMovementSim::FRailState State;
+	MakeSlope(10.0f, 10.0f, Sample, State);
+
+	SonicMovementSim::StepRail(Sample, MakeParams(), State);
+
+	TestTrue(TEXT("Stalled grinder has next to no speed"), State.Velocity.Length() < 1.0f);
+	TestTrue(TEXT("Stalled grinder turns around"), State.bBackwards);
+
+	// Fast enough to make it over, nothing changes direction
+	MakeSlope(10.0f, 20.0f, Sample, State);
+
+	SonicMovementSim::StepRail(Sample, MakeParams(), State);
+
+	TestEqual(TEXT("Slow climb loses the slope's share of speed"), (float)State.Velocity.Length(), 10.0f, 0.01f);
+	TestFalse(TEXT("Slow climb keeps going"), State.bBackwards);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSonicRailJumpTest, "SonicGame.Movement.RailJump", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSonicRailJumpTest::RunTest(const FString& Parameters)
+{
+	using namespace SonicMovementSimTests;
+
+	// Jumping straight after a step, the way DoRailJump does, both ways along a rail
+	for (const bool bBackwards : { false, true })
+	{
+		SonicMovementSim::FRailSample Sample;
+		SonicMovementSim::FRailState State;
+		MakeSlope(0.0f, 1000.0f, Sample, State);
+		Sample.Tangent = FRotator(0.0f, 30.0f, 0.0f).Vector();
+		State.bBackwards = bBackwards;
+		State.Rotation = FRotator(0.0f, bBackwards ? 210.0f : 30.0f, 0.0f);
+
+		const SonicMovementSim::FRailParams Params = MakeParams();
+		SonicMovementSim::StepRail(Sample, Params, State);
+
+		const FVector GrindDirection = bBackwards ? -Sample.Tangent : Sample.Tangent;
+		const FVector LaunchVelocity = SonicMovementSim::GetRailJumpVelocity(State.Velocity, Sample.Up, Params);
+		const FVector HorizontalLaunch(LaunchVelocity.X, LaunchVelocity.Y, 0.0f);
+
+		const FString Direction = bBackwards ? TEXT("backwards") : TEXT("forwards");
+		TestTrue(FString::Printf(TEXT("Jump grinding %s carries on along the rail"), *Direction), (HorizontalLaunch.GetSafeNormal() | GrindDirection) > 0.99f);
+		TestEqual(FString::Printf(TEXT("Jump grinding %s keeps the grinding speed"), *Direction), (float)HorizontalLaunch.Length(), 1000.0f, 0.01f);
+		TestEqual(FString::Printf(TEXT("Jump grinding %s goes up by the jump height"), *Direction), (float)LaunchVelocity.Z, Params.RailJumpHeight, 0.01f);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,452 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "Enemy.h"
+#include "GrindRail.h"
+#include "SonicGameCharacter.h"
+#include "SonicMovementComponent.h"
+#include "SonicSignificanceSubsystem.h"
+
+/**
+ * Micro-benchmarks for the rail grinding and homing hot paths.
+ * Each test builds a throwaway game world with generated rails and enemies, checks that the paths it times still
+ * do their job, times every call on its own and writes mean and percentile timings to Saved/Automation/Perf as JSON and CSV.
+ * Run headless with: UnrealEditor-Cmd SonicGame -ExecCmds="Automation RunTests SonicGame.Perf;Quit" -nullrhi -unattended
+ */
+namespace SonicPerfBenchmarks
+{
+	/** Calls timed per scenario, after warm-up. */
+	static constexpr int32 NumIterations = 5000;
+
+	static constexpr int32 NumWarmupIterations = 200;
+
+	/** Gap between side by side rails, inside AGrindRail's side rail search distance. */
+	static constexpr float RailSpacing = 200.0f;
+
+	/** Gap between rail spline points. */
+	static constexpr float RailPointSpacing = 500.0f;
+
+	/** Frame time of the grinding scenarios. */
+	static constexpr float GrindDeltaTime = 1.0f / 60.0f;
+
+	struct FBenchmarkResult
+	{
+		FString Name;
+
+		FString Scenario;
+
+		int32 Iterations = 0;
+
+		double MeanNs = 0.0;
+
+		double P50Ns = 0.0;
+
+		double P95Ns = 0.0;
+
+		double P99Ns = 0.0;
+
+		double MaxNs = 0.0;
+	};
+
+	/** Runs Function NumIterations times and collects per-call timings. Setup runs before each call and is not timed. */
+	template <typename SetupType, typename FunctionType>
+	static FBenchmarkResult Measure(const FString& Name, const FString& Scenario, SetupType&& Setup, FunctionType&& Function)
+	{
+		for (int32 i = 0; i < NumWarmupIterations; i++)
+		{
+			Setup(i);
+			Function();
+		}
+
+		TArray<double> Timings;
+		Timings.Reserve(NumIterations);
+
+		for (int32 i = 0; i < NumIterations; i++)
+		{
+			Setup(i);
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Function();
+			const uint64 EndCycles = FPlatformTime::Cycles64();
+
+			Timings.Add(FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1e9);
+		}
+
+		Timings.Sort();
+
+		double Total = 0.0;
+		for (const double Timing : Timings)
+		{
+			Total += Timing;
+		}
+
+		auto Percentile = [&Timings](double Fraction)
+		{
+			return Timings[FMath::Clamp(FMath::FloorToInt32(Fraction * Timings.Num()), 0, Timings.Num() - 1)];
+		};
+
+		FBenchmarkResult Result;
+		Result.Name = Name;
+		Result.Scenario = Scenario;
+		Result.Iterations = Timings.Num();
+		Result.MeanNs = Total / Timings.Num();
+		Result.P50Ns = Percentile(0.5);
+		Result.P95Ns = Percentile(0.95);
+		Result.P99Ns = Percentile(0.99);
+		Result.MaxNs = Timings.Last();
+		return Result;
+	}
+
+	/** Writes the results of one suite next to each other as JSON and CSV, stamped with the run time. */
+	static void WriteResults(const FString& SuiteName, const TArray<FBenchmarkResult>& Results)
+	{
+		const FString OutputDir = FPaths::ProjectSavedDir() / TEXT("Automation") / TEXT("Perf");
+		const FString BaseName = FString::Printf(TEXT("%s-%s"), *SuiteName, *FDateTime::UtcNow().ToString(TEXT("%Y%m%d-%H%M%S")));
+		IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+		FString Json = FString::Printf(TEXT("{\n\t\"suite\": \"%s\",\n\t\"build\": \"%s\",\n\t\"results\": [\n"), *SuiteName, *LexToString(FApp::GetBuildConfiguration()));
+		FString Csv = TEXT("suite,name,scenario,iterations,mean_ns,p50_ns,p95_ns,p99_ns,max_ns\n");
+
+		for (int32 i = 0; i < Results.Num(); i++)
+		{
+			const FBenchmarkResult& Result = Results[i];
+
+			Json += FString::Printf(TEXT("\t\t{ \"name\": \"%s\", \"scenario\": \"%s\", \"iterations\": %d, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p95_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f }%s\n"),
+				*Result.Name, *Result.Scenario, Result.Iterations, Result.MeanNs, Result.P50Ns, Result.P95Ns, Result.P99Ns, Result.MaxNs, i < Results.Num() - 1 ? TEXT(",") : TEXT(""));
+
+			Csv += FString::Printf(TEXT("%s,%s,%s,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n"),
+				*SuiteName, *Result.Name, *Result.Scenario, Result.Iterations, Result.MeanNs, Result.P50Ns, Result.P95Ns, Result.P99Ns, Result.MaxNs);
+		}
+
+		Json += TEXT("\t]\n}\n");
+
+		FFileHelper::SaveStringToFile(Json, *(OutputDir / BaseName + TEXT(".json")));
+		FFileHelper::SaveStringToFile(Csv, *(OutputDir / BaseName + TEXT(".csv")));
+	}
+
+	/** A game world that only exists for the length of one benchmark scenario. */
+	class FBenchmarkWorld
+	{
+	public:
+		FBenchmarkWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("SonicPerfBenchmark"));
+
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+
+			// Nothing ticks the world, give anything reading the frame time a sensible value
+			World->DeltaTimeSeconds = 1.0f / 60.0f;
+		}
+
+		~FBenchmarkWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		/**
+		 * Spawns NumRails parallel rails RailLength long, RailSpacing apart, with a gentle wave so they aren't straight lines.
+		 */
+		void SpawnRails(int32 NumRails, float RailLength)
+		{
+			const int32 NumPoints = FMath::Max(FMath::CeilToInt32(RailLength / RailPointSpacing) + 1, 2);
+
+			for (int32 RailIndex = 0; RailIndex < NumRails; RailIndex++)
+			{
+				const FVector RailOrigin(0.0f, RailIndex * RailSpacing, 0.0f);
+				AGrindRail* Rail = World->SpawnActor<AGrindRail>(RailOrigin, FRotator::ZeroRotator);
+
+				Rail->RailSpline->ClearSplinePoints(false);
+				for (int32 Point = 0; Point < NumPoints; Point++)
+				{
+					const float X = Point * RailLength / (NumPoints - 1);
+					const float Z = FMath::Sin(X * 0.002f) * 150.0f;
+					Rail->RailSpline->AddSplinePoint(RailOrigin + FVector(X, 0.0f, Z), ESplineCoordinateSpace::World, false);
+				}
+				Rail->RailSpline->UpdateSpline();
+
+				// Re-bakes and re-registers the rail now that its spline has been built
+				Rail->BakeRailTable();
+				Rails.Add(Rail);
+			}
+
+			// Normally done on the tick after the rails register
+			for (AGrindRail* Rail : Rails)
+			{
+				Rail->BuildSideRailTable();
+			}
+		}
+
+		/** Spawns NumEnemies enemies scattered over an area Extent across, centred on the origin. */
+		void SpawnEnemies(int32 NumEnemies, float Extent)
+		{
+			FRandomStream Random(NumEnemies);
+			for (int32 i = 0; i < NumEnemies; i++)
+			{
+				const FVector Location(Random.FRandRange(-Extent, Extent) * 0.5f, Random.FRandRange(-Extent, Extent) * 0.5f, Random.FRandRange(-200.0f, 200.0f));
+				World->SpawnActor<AEnemy>(Location, FRotator::ZeroRotator);
+			}
+		}
+
+		ASonicGameCharacter* SpawnCharacter()
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			return World->SpawnActor<ASonicGameCharacter>(FVector(0.0f, 0.0f, 1000.0f), FRotator::ZeroRotator, SpawnParams);
+		}
+
+		/** Puts Character on Rail at Distance as if it had just landed on it, facing the way it will grind. */
+		static void PlaceOnRail(ASonicGameCharacter* Character, AGrindRail* Rail, float Distance, bool bBackwards = false)
+		{
+			const FVector Tangent = Rail->RailSpline->GetTangentAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World).GetSafeNormal();
+			const FVector GrindDirection = bBackwards ? -Tangent : Tangent;
+
+			Character->bIsGrinding = true;
+			Character->bGrindJump = false;
+			Character->bBackwardsGrind = bBackwards;
+			Character->CurrentRail = Rail->RailSpline;
+			Character->RailStartDistance = Distance;
+			Character->GetCharacterMovement()->Velocity = GrindDirection * 1500.0f;
+			Character->SetActorLocationAndRotation(Rail->RailSpline->GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World) + FVector(0.0f, 0.0f, Character->RailOffset),
+				FRotationMatrix::MakeFromX(GrindDirection).Rotator());
+
+			if (USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(Character->GetCharacterMovement()))
+			{
+				SonicMovement->StartGrinding(Rail, Distance, bBackwards);
+			}
+		}
+
+		/** One frame of grinding: the character hands over its tuning, then the movement component steps along the rail. */
+		static void GrindFrame(ASonicGameCharacter* Character)
+		{
+			Character->GrindOnRail(Character->RailStartDistance, Character->CurrentRail);
+			if (USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(Character->GetCharacterMovement()))
+			{
+				SonicMovement->StepGrinding(GrindDeltaTime);
+			}
+		}
+
+		UWorld* World = nullptr;
+
+		TArray<AGrindRail*> Rails;
+	};
+
+	static const int32 RailCounts[] = { 1, 16, 128 };
+
+	static const float RailLengths[] = { 2000.0f, 20000.0f };
+
+	static const int32 EnemyCounts[] = { 16, 256, 2048 };
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSonicRailBenchmarkTest, "SonicGame.Perf.Rails", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FSonicRailBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SonicPerfBenchmarks;
+
+	TArray<FBenchmarkResult> Results;
+
+	for (const int32 NumRails : RailCounts)
+	{
+		for (const float RailLength : RailLengths)
+		{
+			const FString Scenario = FString::Printf(TEXT("rails=%d length=%.0f"), NumRails, RailLength);
+
+			FBenchmarkWorld BenchmarkWorld;
+			BenchmarkWorld.SpawnRails(NumRails, RailLength);
+
+			ASonicGameCharacter* Character = BenchmarkWorld.SpawnCharacter();
+			if (!TestNotNull(TEXT("Character spawned"), Character))
+			{
+				return false;
+			}
+
+			AGrindRail* MiddleRail = BenchmarkWorld.Rails[NumRails / 2];
+			const float MiddleRailLength = MiddleRail->RailSpline->GetSplineLength();
+			FRandomStream Random(NumRails + FMath::RoundToInt32(RailLength));
+
+			// Probes spread over the whole rail field, about half land close enough to attach
+			const FVector FieldMin(0.0f, -RailSpacing, -300.0f);
+			const FVector FieldMax(RailLength, NumRails * RailSpacing, 300.0f);
+			TArray<FVector> Probes;
+			for (int32 i = 0; i < 1024; i++)
+			{
+				const AGrindRail* Rail = BenchmarkWorld.Rails[Random.RandHelper(NumRails)];
+				const FVector OnRail = Rail->RailSpline->GetLocationAtDistanceAlongSpline(Random.FRandRange(0.0f, Rail->RailSpline->GetSplineLength()), ESplineCoordinateSpace::World);
+				Probes.Add(i % 2 == 0 ? OnRail + FVector(0.0f, 0.0f, 60.0f) + Random.VRand() * 20.0f : FVector(Random.FRandRange(FieldMin.X, FieldMax.X), Random.FRandRange(FieldMin.Y, FieldMax.Y), Random.FRandRange(FieldMin.Z, FieldMax.Z)));
+			}
+
+			// A fast path that stops attaching or grinding would still time well, check they do what they're for first
+			int32 NumNearProbes = 0;
+			int32 NumNearProbesAttached = 0;
+			for (int32 i = 0; i < Probes.Num(); i += 2)
+			{
+				Character->bIsGrinding = false;
+				Character->SetActorLocationAndRotation(Probes[i], FRotator::ZeroRotator);
+				Character->DetectGrindRail();
+
+				NumNearProbes++;
+				NumNearProbesAttached += Character->bIsGrinding && Character->CurrentRail ? 1 : 0;
+			}
+			TestEqual(FString::Printf(TEXT("Probes next to a rail attach [%s]"), *Scenario), NumNearProbesAttached, NumNearProbes);
+
+			USonicMovementComponent* SonicMovement = Cast<USonicMovementComponent>(Character->GetCharacterMovement());
+			if (!TestNotNull(TEXT("Character has the Sonic movement component"), SonicMovement))
+			{
+				return false;
+			}
+
+			for (const bool bBackwards : { false, true })
+			{
+				const float StartDistance = bBackwards ? MiddleRailLength - 100.0f : 100.0f;
+				FBenchmarkWorld::PlaceOnRail(Character, MiddleRail, StartDistance, bBackwards);
+
+				const FString Direction = bBackwards ? TEXT("backwards") : TEXT("forwards");
+				bool bAdvancedEveryFrame = true;
+				bool bKeptDirection = true;
+				bool bVelocityAlongRail = true;
+
+				// Short enough to stay clear of the far end of the shortest rail, a rail end launches the character off
+				for (int32 Frame = 0; Frame < 20 && SonicMovement->IsGrinding(); Frame++)
+				{
+					const float PreviousDistance = SonicMovement->GetRailDistance();
+					FBenchmarkWorld::GrindFrame(Character);
+
+					// StepRail covers between 0.55 and 1.15 of twice the speed per second, depending on the slope
+					const float Advance = bBackwards ? PreviousDistance - SonicMovement->GetRailDistance() : SonicMovement->GetRailDistance() - PreviousDistance;
+					const float Speed = SonicMovement->Velocity.Size();
+					bAdvancedEveryFrame &= Speed > 0.0f && Advance >= 2.0f * Speed * GrindDeltaTime * 0.55f - 0.1f && Advance <= 2.0f * Speed * GrindDeltaTime * 1.15f + 0.1f;
+					bKeptDirection &= SonicMovement->IsBackwardsGrind() == bBackwards;
+
+					const FVector Tangent = MiddleRail->RailSpline->GetTangentAtDistanceAlongSpline(SonicMovement->GetRailDistance(), ESplineCoordinateSpace::World).GetSafeNormal();
+					bVelocityAlongRail &= (SonicMovement->Velocity.GetSafeNormal() | (bBackwards ? -Tangent : Tangent)) > 0.9f;
+				}
+
+				TestTrue(FString::Printf(TEXT("Grinding %s stays on the rail [%s]"), *Direction, *Scenario), SonicMovement->IsGrinding() && Character->bIsGrinding);
+				TestTrue(FString::Printf(TEXT("Grinding %s advances the distance by the speed every frame [%s]"), *Direction, *Scenario), bAdvancedEveryFrame);
+				TestTrue(FString::Printf(TEXT("Grinding %s keeps its direction [%s]"), *Direction, *Scenario), bKeptDirection);
+				TestTrue(FString::Printf(TEXT("Grinding %s moves along the rail [%s]"), *Direction, *Scenario), bVelocityAlongRail);
+			}
+
+			Results.Add(Measure(TEXT("DetectGrindRail"), Scenario,
+				[&](int32 i)
+				{
+					Character->bIsGrinding = false;
+					Character->SetActorLocationAndRotation(Probes[i % Probes.Num()], FRotator::ZeroRotator);
+				},
+				[&]() { Character->DetectGrindRail(); }));
+
+			Results.Add(Measure(TEXT("DetectSideRail"), Scenario,
+				[&](int32 i) { FBenchmarkWorld::PlaceOnRail(Character, MiddleRail, MiddleRailLength * ((i % 97) + 1) / 99.0f); },
+				[&]() { Character->DetectSideRail(); }));
+
+			Results.Add(Measure(TEXT("GrindOnRail"), Scenario,
+				[&](int32 i)
+				{
+					// Grind continuously, starting over whenever the end of the rail is reached
+					if (!Character->bIsGrinding || Character->RailStartDistance >= MiddleRailLength - 100.0f || i == 0)
+					{
+						FBenchmarkWorld::PlaceOnRail(Character, MiddleRail, 10.0f);
+					}
+				},
+				[&]() { FBenchmarkWorld::GrindFrame(Character); }));
+
+			// Walks the rail at grinding speed, so the cached segment is hit the way it is in game
+			Results.Add(Measure(TEXT("GetRailFrameAtDistance"), Scenario,
+				[](int32) {},
+				[&, i = 0]() mutable { MiddleRail->GetRailFrameAtDistance(FMath::Fmod(i++ * 25.0f, MiddleRailLength)); }));
+
+			Results.Add(Measure(TEXT("GetClosestDistanceToLocation"), Scenario,
+				[](int32) {},
+				[&, i = 0]() mutable { Character->GetClosestDistanceToLocation(MiddleRail->RailSpline, Probes[i++ % Probes.Num()] + FVector(0.0f, (NumRails / 2) * RailSpacing, 0.0f), 5.0f); }));
+		}
+	}
+
+	WriteResults(TEXT("Rails"), Results);
+
+	for (const FBenchmarkResult& Result : Results)
+	{
+		AddInfo(FString::Printf(TEXT("%s [%s]: mean %.0f ns, p50 %.0f ns, p95 %.0f ns, p99 %.0f ns"), *Result.Name, *Result.Scenario, Result.MeanNs, Result.P50Ns, Result.P95Ns, Result.P99Ns));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSonicHomingBenchmarkTest, "SonicGame.Perf.Homing", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FSonicHomingBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SonicPerfBenchmarks;
+
+	TArray<FBenchmarkResult> Results;
+
+	for (const int32 NumEnemies : EnemyCounts)
+	{
+		const FString Scenario = FString::Printf(TEXT("enemies=%d"), NumEnemies);
+
+		// Keep roughly the same density as the enemy count grows, so bigger scenarios are bigger levels
+		const float Extent = FMath::Sqrt((float)NumEnemies) * 400.0f;
+
+		FBenchmarkWorld BenchmarkWorld;
+		BenchmarkWorld.SpawnEnemies(NumEnemies, Extent);
+
+		ASonicGameCharacter* Character = BenchmarkWorld.SpawnCharacter();
+		if (!TestNotNull(TEXT("Character spawned"), Character))
+		{
+			return false;
+		}
+
+		FRandomStream Random(NumEnemies);
+
+		Results.Add(Measure(TEXT("GetNearestHomingTarget"), Scenario,
+			[&](int32)
+			{
+				const FVector Location(Random.FRandRange(-Extent, Extent) * 0.5f, Random.FRandRange(-Extent, Extent) * 0.5f, 0.0f);
+				Character->SetActorLocationAndRotation(Location, FRotator(0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f));
+			},
+			[&]() { Character->GetNearestHomingTarget(Character->HomingRadius); }));
+
+		if (USonicSignificanceSubsystem* SignificanceSubsystem = BenchmarkWorld.World->GetSubsystem<USonicSignificanceSubsystem>())
+		{
+			FVector ViewLocation = FVector::ZeroVector;
+			FVector ViewDirection = FVector::ForwardVector;
+
+			Results.Add(Measure(TEXT("UpdateSignificance"), Scenario,
+				[&](int32)
+				{
+					ViewLocation = FVector(Random.FRandRange(-Extent, Extent) * 0.5f, Random.FRandRange(-Extent, Extent) * 0.5f, 0.0f);
+					ViewDirection = FRotator(0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f).Vector();
+				},
+				[&]() { SignificanceSubsystem->UpdateSignificance(ViewLocation, ViewDirection); }));
+		}
+	}
+
+	WriteResults(TEXT("Homing"), Results);
+
+	for (const FBenchmarkResult& Result : Results)
+	{
+		AddInfo(FString::Printf(TEXT("%s [%s]: mean %.0f ns, p50 %.0f ns, p95 %.0f ns, p99 %.0f ns"), *Result.Name, *Result.Scenario, Result.MeanNs, Result.P50Ns, Result.P95Ns, Result.P99Ns));
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
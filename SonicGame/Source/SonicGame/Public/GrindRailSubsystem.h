@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "GrindRailSubsystem.generated.h"
+
+class AGrindRail;
+
+/** Result of a rail query against the grind rail index. */
+USTRUCT(BlueprintType)
+struct SONICGAME_API FGrindRailQueryResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<AGrindRail> Rail = nullptr;
+
+	/** Closest point on the rail to the query location. */
+	UPROPERTY(BlueprintReadOnly)
+	FVector Location = FVector::ZeroVector;
+
+	/** Distance along the rail of Location. */
+	UPROPERTY(BlueprintReadOnly)
+	float Distance = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float DistanceSq = 0.0f;
+};
+
+/**
+ * World-wide uniform grid of grind rail segments, built from each rail's baked arc-length samples.
+ * Lets the player find nearby rails without touching the physics scene.
+ */
+UCLASS(config=Game)
+class SONICGAME_API UGrindRailSubsystem : public USonicWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Adds the rail's segments to the grid, replacing any previous registration. */
+	void RegisterRail(AGrindRail* Rail);
+
+	void UnregisterRail(AGrindRail* Rail);
+
+	bool IsRailRegistered(const AGrindRail* Rail) const { return RegisteredRails.Contains(Rail); }
+
+	/**
+	 * Finds the closest rail within Radius of Location.
+	 * Rails with collision disabled and IgnoreRail are skipped.
+	 * @return True if a rail was found
+	 */
+	bool FindClosestRail(const FVector& Location, float Radius, FGrindRailQueryResult& OutResult, const AGrindRail* IgnoreRail = nullptr) const;
+
+	/**
+	 * Finds the first rail hit by a sphere of Radius moved from Start to End.
+	 * Unlike FindClosestRail this includes rails with collision disabled.
+	 * @return True if a rail was found
+	 */
+	bool FindFirstRailAlongSegment(const FVector& Start, const FVector& End, float Radius, FGrindRailQueryResult& OutResult, const AGrindRail* IgnoreRail = nullptr) const;
+
+	/** Bumped every time a rail is registered or unregistered. */
+	uint32 GetRailSetVersion() const { return RailSetVersion; }
+
+	const TArray<TObjectPtr<AGrindRail>>& GetRails() const { return Rails; }
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FRailSegmentRef
+	{
+		AGrindRail* Rail;
+		int32 Segment;
+	};
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** Rails inserted into the grid, with the cells they were inserted into and their bounds. */
+	struct FRegisteredRail
+	{
+		TArray<FIntVector> Cells;
+
+		/** Bounds of the rail's samples grown by its collision radius, what other rails' side searches can hit. */
+		FBox Bounds = FBox(ForceInit);
+	};
+
+	/**
+	 * Marks the side rail tables of the rails whose side searches reach Bounds, the bounds of a rail around RailCells
+	 * that was just added or removed, and schedules the rebuild.
+	 */
+	void MarkNearbySideRailTablesStale(const AGrindRail* ChangedRail, const TArray<FIntVector>& RailCells, const FBox& Bounds);
+
+	/** Rebuilds the side rail tables marked stale since the last rebuild. */
+	void RebuildSideRailTables();
+
+	void RequestSideRailTableRebuild();
+
+public:
+	/** Size of one grid cell. Should be a few times larger than a typical rail query radius. */
+	UPROPERTY(Config)
+	float CellSize = 500.0f;
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<AGrindRail>> Rails;
+
+	TMap<FIntVector, TArray<FRailSegmentRef>> Cells;
+
+	/** Cells each rail was inserted into, so it can be removed without scanning the whole grid. */
+	TMap<const AGrindRail*, FRegisteredRail> RegisteredRails;
+
+	/** Rails whose side rail tables are waiting for the next rebuild. */
+	TSet<AGrindRail*> PendingSideRailTables;
+
+	/** Longest side search of any registered rail, how far from a changed rail stale tables are looked for. */
+	float MaxSideRailSearchReach = 0.0f;
+
+	uint32 RailSetVersion = 0;
+
+	bool bSideRailRebuildPending = false;
+};
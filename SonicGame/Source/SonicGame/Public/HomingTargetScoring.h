@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What the homing scoring pass is looking for. */
+struct FHomingScoringParams
+{
+	FVector Origin = FVector::ZeroVector;
+
+	/** Direction the player is facing, used for the view cone. */
+	FVector Forward = FVector::ForwardVector;
+
+	/** Direction the camera is looking. */
+	FVector CameraForward = FVector::ForwardVector;
+
+	float Radius = 0.0f;
+
+	/** Cosine of the widest angle from Forward a target can be at. */
+	float MinViewCos = -1.0f;
+
+	/** Weight of being close, scaled 0-1 across Radius. */
+	float DistanceWeight = 1.0f;
+
+	/** Weight of being straight ahead of the player. */
+	float FacingWeight = 1.0f;
+
+	/** Weight of being straight ahead of the camera. */
+	float CameraWeight = 0.0f;
+};
+
+/**
+ * Homing candidate locations in structure-of-arrays form, padded to a multiple of four
+ * so they can be scored with vector registers.
+ */
+struct SONICGAME_API FHomingCandidateBatch
+{
+public:
+	void Reset();
+
+	void Add(const FVector& Location);
+
+	int32 Num() const { return NumCandidates; }
+
+	/**
+	 * Scores every candidate in one SIMD pass and returns the best one inside the radius and view cone.
+	 * @param OutFacingCos	Cosine of the angle between Params.Forward and the winner
+	 * @return Index of the winning candidate, or INDEX_NONE
+	 */
+	int32 FindBest(const FHomingScoringParams& Params, float& OutFacingCos) const;
+
+private:
+	TArray<float, TAlignedHeapAllocator<16>> X;
+
+	TArray<float, TAlignedHeapAllocator<16>> Y;
+
+	TArray<float, TAlignedHeapAllocator<16>> Z;
+
+	int32 NumCandidates = 0;
+};
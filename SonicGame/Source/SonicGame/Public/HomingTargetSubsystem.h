@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "HomingTargetSubsystem.generated.h"
+
+/**
+ * Registry of everything the player can home in on, bucketed into a spatial hash.
+ * Replaces sphere traces against the physics scene when looking for the nearest target.
+ * Targets are held weakly, so actors destroyed between queries simply drop out.
+ */
+UCLASS(config=Game)
+class SONICGAME_API UHomingTargetSubsystem : public USonicTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterTarget(AActor* Target);
+
+	void UnregisterTarget(AActor* Target);
+
+	/**
+	 * Collects every live target whose location is within Radius of Location.
+	 * @param IgnoreActor	Actor to leave out of the results, usually the one searching
+	 */
+	void GatherTargetsInRadius(const FVector& Location, float Radius, TArray<AActor*>& OutTargets, const AActor* IgnoreActor = nullptr) const;
+
+	/** Finds the closest live target within Radius of Location, or null if there is none. */
+	AActor* FindNearestTarget(const FVector& Location, float Radius, const AActor* IgnoreActor = nullptr) const;
+
+	int32 GetNumTargets() const { return Targets.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FHomingTargetEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		FVector Location;
+
+		FIntVector Cell;
+	};
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	void AddToCell(int32 EntryIndex);
+
+	void RemoveFromCell(int32 EntryIndex);
+
+	void RemoveEntry(int32 EntryIndex);
+
+public:
+	/** Size of one hash cell. Should be about the homing radius. */
+	UPROPERTY(Config)
+	float CellSize = 500.0f;
+
+private:
+	/** Dense list of targets, cells store indices into it. */
+	TArray<FHomingTargetEntry> Targets;
+
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	TMap<TWeakObjectPtr<AActor>, int32> TargetIndices;
+};
@@ -40,12 +40,26 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable)
 	void SetTargetDirectionFromDistance(float Distance);
 
+	/** Called when a pooled projection is handed out again. Restart anything BeginPlay would normally start here. */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnReusedFromPool();
+
+	/** Called when the projection is put back into the pool. */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnReturnedToPool();
+
+	/** Puts a pooled projection back into play with fresh state. */
+	void ActivateFromPool(const FTransform& Transform, const FVector& InStartLocation, const FVector& InTargetDirection);
+
+	/** Hides and freezes the projection while it waits in the pool. */
+	void DeactivateToPool();
+
+	bool IsInPool() const { return bInPool; }
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
+private:
+	bool bInPool = false;
 };
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "ProjectionPoolSubsystem.generated.h"
+
+class AProjectionActorBase;
+
+USTRUCT(BlueprintType)
+struct SONICGAME_API FProjectionPoolStats
+{
+	GENERATED_BODY()
+
+	/** Projections handed out from the pool. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 PoolHits = 0;
+
+	/** Projections that had to be spawned because the pool was empty. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 PoolMisses = 0;
+
+	/** Projections currently waiting in the pool. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumPooled = 0;
+
+	/** Projections currently handed out. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumActive = 0;
+};
+
+USTRUCT()
+struct FProjectionPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<AProjectionActorBase>> FreeProjections;
+};
+
+/**
+ * Keeps projection actors alive between attacks instead of spawning and destroying them every time.
+ */
+UCLASS()
+class SONICGAME_API UProjectionPoolSubsystem : public USonicWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Spawns projections of ProjectionClass until at least Count are waiting in the pool. */
+	UFUNCTION(BlueprintCallable)
+	void PrewarmProjections(TSubclassOf<AProjectionActorBase> ProjectionClass, int32 Count);
+
+	/**
+	 * Hands out a projection, reusing a pooled one when possible.
+	 * @param StartLocation		Location the projection moves out to
+	 * @param TargetDirection	Axis the projection is launched along
+	 */
+	AProjectionActorBase* AcquireProjection(TSubclassOf<AProjectionActorBase> ProjectionClass, const FTransform& Transform, const FVector& StartLocation, const FVector& TargetDirection);
+
+	/** Returns a projection to the pool. */
+	UFUNCTION(BlueprintCallable)
+	void ReleaseProjection(AProjectionActorBase* Projection);
+
+	UFUNCTION(BlueprintCallable)
+	FProjectionPoolStats GetPoolStats() const { return Stats; }
+
+	virtual void Deinitialize() override;
+
+private:
+	AProjectionActorBase* SpawnProjection(TSubclassOf<AProjectionActorBase> ProjectionClass, const FTransform& Transform, const FVector& StartLocation);
+
+private:
+	UPROPERTY()
+	TMap<TSubclassOf<AProjectionActorBase>, FProjectionPool> Pools;
+
+	FProjectionPoolStats Stats;
+};
@@ -4,8 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Components/SceneComponent.h"
+#include "ProjectionSwarm.h"
 #include "ProjectionSpawnerComponent.generated.h"
 
+class UStaticMesh;
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), BlueprintType, Blueprintable)
 class SONICGAME_API UProjectionSpawnerComponent : public USceneComponent
@@ -28,6 +30,40 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<class AProjectionActorBase*> ActiveProjections;
 
+	/**
+	 * Reuse projection actors from the world's projection pool instead of spawning and destroying them.
+	 * Only turn on for projection classes that restart their motion in OnReusedFromPool, BeginPlay only runs for the first use.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pooling")
+	bool bUseProjectionPool = false;
+
+	/** Projection class to spawn into the pool when play begins. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pooling")
+	TSubclassOf<class AProjectionActorBase> PrewarmProjectionClass;
+
+	/** How many projections to spawn into the pool when play begins. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pooling")
+	int32 NumPrewarmedProjections = 0;
+
+	/**
+	 * Simulate projections in one batch and draw them as mesh instances instead of spawning an actor for each.
+	 * Swarm projections fly straight to their target and ignore TargetDirection, so they won't move like the
+	 * projection Blueprint. Leave off unless that is acceptable for the attack.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Swarm")
+	bool bUseProjectionSwarm = false;
+
+	/** Mesh drawn for every swarm projection. Swarm mode is skipped when this is not set. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Swarm")
+	TObjectPtr<UStaticMesh> SwarmMesh;
+
+	/** How quickly swarm projections move to their target, same as the projection actor's InterpSpeed. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Swarm")
+	float SwarmInterpSpeed = 5.f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Swarm")
+	TObjectPtr<class UInstancedStaticMeshComponent> SwarmInstances;
+
 	int32 NumProjectionsSpawned = 0;
 
 	FTimerHandle SpawnTimerHandle;
@@ -54,7 +90,22 @@ public:
 	
 	FVector CalculateProjectionTargetLocation(const FVector Direction, float Distance);
 
+	UFUNCTION(BlueprintPure)
+	int32 GetNumSwarmProjections() const { return ProjectionSwarm.Num(); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+
+private:
+	bool CanUseProjectionSwarm() const;
+
+	void AddSwarmProjection(const FTransform& Transform, const FVector TargetLocation);
+
+	FProjectionSwarm ProjectionSwarm;
+
+	/** Scratch buffer for pushing swarm transforms to the instances. */
+	TArray<FTransform> SwarmTransforms;
 };
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Lightweight projections kept in structure-of-arrays form and moved in one batch pass,
+ * instead of one ticking actor each. Every projection interpolates in a straight line from
+ * where it spawned to its target at its own InterpSpeed, facing the way it travels.
+ *
+ * This does not match the projection actors. Their Blueprint steers along TargetDirection
+ * (SetTargetDirectionFromDistance) and turns as it goes, and none of that is simulated here.
+ */
+struct SONICGAME_API FProjectionSwarm
+{
+public:
+	void Reset();
+
+	/** Adds a projection and returns its index. */
+	int32 Add(const FTransform& SpawnTransform, const FVector& TargetLocation, float InterpSpeed);
+
+	int32 Num() const { return Positions.Num(); }
+
+	/** Number of projections still moving towards their target. */
+	int32 NumMoving() const { return NumMovingProjections; }
+
+	/** Moves every projection towards its target. */
+	void Update(float DeltaTime);
+
+	FTransform GetTransform(int32 Index) const { return FTransform(Rotations[Index], Positions[Index], Scales[Index]); }
+
+	/** Writes one world-space transform per projection, in index order. */
+	void GetTransforms(TArray<FTransform>& OutTransforms) const;
+
+	const TArray<FVector>& GetPositions() const { return Positions; }
+
+private:
+	TArray<FVector> Positions;
+
+	TArray<FVector> Targets;
+
+	/** Facing of each projection, pointed along its direction of travel. */
+	TArray<FQuat> Rotations;
+
+	TArray<FVector> Scales;
+
+	TArray<float> InterpSpeeds;
+
+	/** Projections that have reached their target are skipped by Update. */
+	TBitArray<> Moving;
+
+	int32 NumMovingProjections = 0;
+};
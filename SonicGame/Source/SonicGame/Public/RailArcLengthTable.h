@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+/**
+ * Uniform arc-length samples of a spline plus a segment tree of their bounds.
+ * Answers "which distance along the rail is closest to this point" in O(log n)
+ * instead of walking the spline. The result is exact against the sampled
+ * polyline and within GetMaxError() of the real spline.
+ */
+struct SONICGAME_API FRailArcLengthTable
+{
+public:
+	/** Samples the spline every SampleSpacing units (world space) and builds the tree. */
+	void Build(const USplineComponent* Spline, float SampleSpacing);
+
+	/**
+	 * Builds the tree from samples that were already taken along Spline, such as ones loaded from a rail bake.
+	 * InSamples must hold GetNumSamples(RailLength, SampleSpacing) world space locations, otherwise the table is left empty.
+	 */
+	void BuildFromSamples(const USplineComponent* Spline, TArray<FVector>&& InSamples, float SampleSpacing, float RailLength, float MaxError);
+
+	/** Number of samples a rail of RailLength is split into: one every SampleSpacing units plus one at the end. */
+	static int32 GetNumSamples(float InRailLength, float InSampleSpacing);
+
+	void Reset();
+
+	bool IsBuilt() const { return Samples.Num() >= 2; }
+
+	/** True if the spline has been edited or moved since the table was built. */
+	bool IsStale(const USplineComponent* Spline) const;
+
+	/**
+	 * Finds the distance along the rail closest to Location.
+	 * @param OutDistanceSq	Squared distance from Location to the closest point on the sampled rail
+	 * @return Distance along the rail, or -1 if the table is empty
+	 */
+	float FindClosestDistance(const FVector& Location, float* OutDistanceSq = nullptr) const;
+
+	/** Location on the sampled rail at Distance, linearly interpolated between samples. */
+	FVector GetLocationAtDistance(float Distance) const;
+
+	/** Distance along the rail of a point lying on the polyline segment that starts at sample Segment. */
+	float GetDistanceAtSegmentPoint(int32 Segment, const FVector& Point) const;
+
+	/** Largest deviation between the sampled polyline and the real spline, measured at build time. */
+	float GetMaxError() const { return MaxError; }
+
+	float GetSampleSpacing() const { return SampleSpacing; }
+
+	float GetRailLength() const { return RailLength; }
+
+	const TArray<FVector>& GetSamples() const { return Samples; }
+
+private:
+	void BuildTree();
+
+	float GetDistanceAtSample(int32 Index) const;
+
+	void FindClosestInNode(int32 Node, const FVector& Location, float& BestDistanceSq, float& BestDistance) const;
+
+	void FindClosestInLeaf(int32 Leaf, const FVector& Location, float& BestDistanceSq, float& BestDistance) const;
+
+private:
+	/** Number of polyline segments grouped under one leaf of the tree. */
+	static constexpr int32 SegmentsPerLeaf = 8;
+
+	TArray<FVector> Samples;
+
+	/** Implicit binary tree: node N has children 2N and 2N+1, leaves start at NumLeaves. */
+	TArray<FBox> Nodes;
+
+	int32 NumLeaves = 0;
+
+	float SampleSpacing = 0.0f;
+
+	float RailLength = 0.0f;
+
+	float MaxError = 0.0f;
+
+	uint32 SplineVersion = 0;
+
+	FTransform SplineTransform;
+};
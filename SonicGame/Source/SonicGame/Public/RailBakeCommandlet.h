@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RailBakeCommandlet.generated.h"
+
+/**
+ * Bakes the grind rails of maps into rail bake assets and saves the assets and the rails' packages.
+ * World Partition maps have all their rails loaded for the bake, so their assets only hold rails that still exist.
+ * Usage: UnrealEditor-Cmd SonicGame -run=RailBake [-Map=/Game/Maps/MapA+/Game/Maps/MapB]
+ * Bakes every map in the project's content folder when no maps are given.
+ */
+UCLASS()
+class URailBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URailBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "RailBakeData.generated.h"
+
+class AGrindRail;
+class ULevel;
+class USplineComponent;
+struct FRailFrame;
+
+/** One quantized arc-length sample of a baked rail, in the rail spline's local space. */
+struct FRailBakedSample
+{
+	/** Location within the rail's bounds, 0 at BoundsMin and 65535 at BoundsMin + BoundsSize. */
+	uint16 Location[3] = {};
+
+	/** Octahedron encoded direction of the spline. */
+	int16 Tangent[2] = {};
+
+	/** Octahedron encoded up vector, which carries the roll of the rail. */
+	int16 Up[2] = {};
+
+	friend FArchive& operator<<(FArchive& Ar, FRailBakedSample& Sample)
+	{
+		Ar << Sample.Location[0] << Sample.Location[1] << Sample.Location[2];
+		Ar << Sample.Tangent[0] << Sample.Tangent[1];
+		Ar << Sample.Up[0] << Sample.Up[1];
+		return Ar;
+	}
+};
+
+/** Baked samples of one rail shape, shared by every rail in the level with the same spline and sample spacing. */
+struct FBakedRail
+{
+	/** URailBakeData::ComputeShapeHash of the spline the samples were taken from. */
+	uint64 ShapeHash = 0;
+
+	float SampleSpacing = 0.0f;
+
+	float RailLength = 0.0f;
+
+	/** Largest distance between the decoded polyline and the spline, quantization included, in local space. */
+	float MaxError = 0.0f;
+
+	FVector3f BoundsMin = FVector3f::ZeroVector;
+
+	FVector3f BoundsSize = FVector3f::OneVector;
+
+	/** One sample every SampleSpacing units plus one at the end, like FRailArcLengthTable. */
+	TArray<FRailBakedSample> Samples;
+
+	friend FArchive& operator<<(FArchive& Ar, FBakedRail& Rail)
+	{
+		Ar << Rail.ShapeHash << Rail.SampleSpacing << Rail.RailLength << Rail.MaxError;
+		Ar << Rail.BoundsMin << Rail.BoundsSize;
+		Rail.Samples.BulkSerialize(Ar);
+		return Ar;
+	}
+};
+
+/**
+ * Quantized arc-length samples of every grind rail in a level, so rails don't have to sample their splines when the level loads.
+ * Made by the RailBake commandlet or the Bake Rails In Level button on any rail, and loaded along with the level through the rails referencing it.
+ * Samples are stored in spline space, so rails with the same shape share one entry wherever they are placed.
+ * Changing FRailBakedSample or FBakedRail means every level's rails have to be baked again.
+ */
+UCLASS()
+class SONICGAME_API URailBakeData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Hash of everything about the local shape of Spline that changes its samples. */
+	static uint64 ComputeShapeHash(const USplineComponent* Spline);
+
+	/** True if baked rail Index was baked from a spline shaped like Spline, with SampleSpacing. */
+	bool IsBakeValidFor(int32 Index, const USplineComponent* Spline, float SampleSpacing) const;
+
+	/**
+	 * Decodes the sample locations of baked rail Index into world space.
+	 * @param SplineTransform	Component transform of the rail's spline
+	 * @param OutMaxError		Error bound of the decoded samples against the spline, in world units
+	 */
+	void DecodeLocations(int32 Index, const FTransform& SplineTransform, TArray<FVector>& OutLocations, float& OutMaxError) const;
+
+	/**
+	 * Rail frame at Distance along baked rail Index, interpolated between the two nearest samples.
+	 * The tangent is normalized, unlike AGrindRail::GetRailFrameAtDistance.
+	 */
+	FRailFrame GetFrameAtDistance(int32 Index, float Distance, const FTransform& SplineTransform) const;
+
+	int32 GetNumBakedRails() const { return BakedRails.Num(); }
+
+	const FBakedRail& GetBakedRail(int32 Index) const { return BakedRails[Index]; }
+
+	virtual void Serialize(FArchive& Ar) override;
+
+#if WITH_EDITOR
+	/** Index of the baked rail matching Spline and SampleSpacing, baking it if no rail of the same shape has been baked yet. */
+	int32 AddRail(const USplineComponent* Spline, float SampleSpacing);
+
+	/**
+	 * Bakes every loaded rail in Level into the level's rail bake asset, creating the asset if needed, and points the rails at it.
+	 * In a World Partition map the rails that aren't loaded keep their entries, so the asset only grows until the RailBake commandlet runs.
+	 * The asset and the rails' packages are marked dirty but not saved.
+	 * @return The bake asset, or null if the level has no loaded rails or has never been saved
+	 */
+	static URailBakeData* BakeLevel(ULevel* Level);
+
+	/**
+	 * Bakes Rails into the rail bake asset of Level, creating the asset if needed, and points the rails at it.
+	 * @param bRemoveOldEntries	Start the asset over so deleted or reshaped rails don't leave entries behind.
+	 *							Only when Rails holds every rail using the asset, any other rail would be left with a stale index.
+	 */
+	static URailBakeData* BakeRails(ULevel* Level, const TArray<AGrindRail*>& Rails, bool bRemoveOldEntries);
+#endif
+
+private:
+	TArray<FBakedRail> BakedRails;
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Removes element Index from each array by moving the last element into its place.
+ * Keeps arrays that run parallel to one another lined up.
+ */
+template<typename... ArrayTypes>
+void SonicRemoveAtSwap(int32 Index, ArrayTypes&... Arrays)
+{
+	(Arrays.RemoveAtSwap(Index, 1, false), ...);
+}
+
+/**
+ * Dense list of registered actors with a lookup from actor to index, for subsystems that keep
+ * their per-actor data in arrays running parallel to it.
+ * Entries are removed by swapping the last one into the hole, so the parallel arrays have to be
+ * passed to RemoveAtSwap to stay lined up.
+ */
+template<typename ActorType>
+class TSonicActorRegistry
+{
+public:
+	/** Adds Actor at the end and returns its index, or INDEX_NONE if it is null or already registered. */
+	int32 Add(ActorType* Actor)
+	{
+		if (!Actor || Indices.Contains(Actor))
+		{
+			return INDEX_NONE;
+		}
+
+		const int32 Index = Actors.Add(Actor);
+		Indices.Add(Actor, Index);
+		return Index;
+	}
+
+	/** Index of Actor, INDEX_NONE if it isn't registered. */
+	int32 Find(const ActorType* Actor) const
+	{
+		const int32* Index = Indices.Find(Actor);
+		return Index ? *Index : INDEX_NONE;
+	}
+
+	/**
+	 * Unregisters the actor at Index but keeps its entry, for when the parallel arrays can't change size right now.
+	 * The entry reads as a null actor until it is removed with RemoveAtSwap.
+	 */
+	void ResetAt(int32 Index)
+	{
+		Indices.Remove(Actors[Index]);
+		Actors[Index].Reset();
+	}
+
+	/** Removes the entry at Index and the element at Index of every parallel array. */
+	template<typename... ParallelArrayTypes>
+	void RemoveAtSwap(int32 Index, ParallelArrayTypes&... ParallelArrays)
+	{
+		Indices.Remove(Actors[Index]);
+		SonicRemoveAtSwap(Index, Actors, ParallelArrays...);
+
+		// The last entry moved into the hole
+		if (Actors.IsValidIndex(Index) && Actors[Index].IsValid())
+		{
+			Indices.Add(Actors[Index], Index);
+		}
+	}
+
+	/** Actor at Index, null once it has been destroyed or reset. */
+	ActorType* Get(int32 Index) const { return Actors[Index].Get(); }
+
+	int32 Num() const { return Actors.Num(); }
+
+	void Empty()
+	{
+		Actors.Empty();
+		Indices.Empty();
+	}
+
+private:
+	TArray<TWeakObjectPtr<ActorType>> Actors;
+
+	TMap<TWeakObjectPtr<ActorType>, int32> Indices;
+};
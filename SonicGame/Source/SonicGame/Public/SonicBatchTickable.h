@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "SonicBatchTickable.generated.h"
+
+UINTERFACE(MinimalAPI, meta = (CannotImplementInterfaceInBlueprint))
+class USonicBatchTickable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Per-frame work done by USonicTickManagerSubsystem in one loop over every registered actor,
+ * so the actor itself doesn't need a tick function.
+ */
+class SONICGAME_API ISonicBatchTickable
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @param DistanceToPlayer	Distance from the actor to the player pawn, or a very large number if there is no player
+	 */
+	virtual void BatchTick(float DeltaTime, float DistanceToPlayer) = 0;
+};
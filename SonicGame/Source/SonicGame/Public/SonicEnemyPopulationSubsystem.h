@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "SonicEnemyPopulationSubsystem.generated.h"
+
+class AEnemy;
+
+/**
+ * Keeps enemies far from the player as a few bytes of data instead of whole actors.
+ * Every enemy with bCanBeDormant has an entry here for as long as it is alive. Entries are promoted to an
+ * AEnemy near the player and demoted back, destroying the actor, once the player has moved away.
+ * Promotion always happens beyond the player's homing radius, so homing and destruction only ever see actors.
+ * Enemies are respawned from their class, per-instance edits made in the level are lost when they go dormant.
+ * Distances are set with the sonic.Population.* console variables.
+ */
+UCLASS()
+class SONICGAME_API USonicEnemyPopulationSubsystem : public USonicTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Adds an enemy that has just begun play. It is destroyed and kept as a dormant entry if the player
+	 * is out of promotion range, otherwise it stays and becomes the actor of its new entry.
+	 */
+	void AddEnemy(AEnemy* Enemy);
+
+	/** Called by enemies with an entry when they end play. Enemies destroyed by gameplay lose their entry for good. */
+	void OnEnemyEndPlay(AEnemy* Enemy, EEndPlayReason::Type EndPlayReason);
+
+	/** Promotes and demotes entries around Location. */
+	void UpdatePopulation(const FVector& Location, float PromoteDistance, float DemoteDistance);
+
+	int32 GetNumEnemies() const { return Locations.Num(); }
+
+	int32 GetNumPromotedEnemies() const { return NumPromoted; }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+private:
+	void Promote(int32 EntryIndex);
+
+	void Demote(int32 EntryIndex);
+
+	/** Copies where Enemy is now into its entry. */
+	void StoreTransform(int32 EntryIndex, const AEnemy* Enemy);
+
+	void RemoveEntry(int32 EntryIndex);
+
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+
+	/** Promotion distance for the current player, pushed out past their homing radius if it is set too low. */
+	float GetPromoteDistance(const APawn* Player) const;
+
+private:
+	/** Entries, one element per enemy in each array. */
+	TArray<FVector3f> Locations;
+
+	TArray<FQuat4f> Rotations;
+
+	TArray<FVector3f> Scales;
+
+	/** Index into Classes. */
+	TArray<uint16> ClassIndices;
+
+	/** Index into Levels. */
+	TArray<uint16> LevelIndices;
+
+	/** Actor of each entry while it is promoted. */
+	TArray<TWeakObjectPtr<AEnemy>> Actors;
+
+	/** Enemy classes shared by the entries. */
+	UPROPERTY()
+	TArray<TSubclassOf<AEnemy>> Classes;
+
+	/** Levels the entries were placed in and are respawned into. */
+	TArray<TWeakObjectPtr<ULevel>> Levels;
+
+	int32 NumPromoted = 0;
+
+	/** Enemy being destroyed by Demote, so its EndPlay keeps the entry. */
+	AEnemy* DemotingEnemy = nullptr;
+
+	float TimeSinceUpdate = TNumericLimits<float>::Max();
+
+	FDelegateHandle LevelRemovedHandle;
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "CollisionQueryParams.h"
+
+/** A point of ground ahead of a moving character. */
+struct FSonicFloorSample
+{
+	/** Distance along the probed path from where the probe started. */
+	float Distance = 0.0f;
+
+	FVector Location = FVector::ZeroVector;
+
+	FVector Normal = FVector::UpVector;
+
+	/** Direction of travel along the ground at this point. */
+	FVector Forward = FVector::ForwardVector;
+};
+
+/**
+ * The ground ahead of a fast moving character, found every so often by following its velocity over the surface
+ * with a few line traces. Between probes the floor anywhere along the path is interpolated from the samples,
+ * so readers get a floor that isn't a frame behind without tracing every frame.
+ */
+struct SONICGAME_API FSonicFloorProbeCache
+{
+public:
+	/**
+	 * Traces the ground ahead, bending the path with every surface it finds. Stops early at a drop or a wall.
+	 * @param Origin			Point on the floor the path starts at
+	 * @param Up				Floor normal at Origin
+	 * @param Direction		Direction of travel, flattened onto the floor
+	 * @param SampleSpacing	Distance between samples along the path, also how far above and below each sample is traced
+	 * @param NumSamples		Samples to take after Origin
+	 */
+	void Probe(const UWorld* World, const FVector& Origin, const FVector& Up, const FVector& Direction, float SampleSpacing, int32 NumSamples,
+		ECollisionChannel Channel, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams);
+
+	void Invalidate();
+
+	bool IsValid() const { return Samples.Num() >= 2; }
+
+	/** Moves the character's position along the probed path. */
+	void Advance(float Distance) { TravelledDistance += Distance; }
+
+	/** Probed path left in front of the character. */
+	float GetRemainingDistance() const { return IsValid() ? Samples.Last().Distance - TravelledDistance : 0.0f; }
+
+	/**
+	 * Floor LeadDistance ahead of the character's position on the path, interpolated between the samples either side.
+	 * @return False if the cache is empty or that point is beyond the probed path
+	 */
+	bool GetFloorAhead(float LeadDistance, FSonicFloorSample& OutSample) const;
+
+private:
+	TArray<FSonicFloorSample, TInlineAllocator<8>> Samples;
+
+	float TravelledDistance = 0.0f;
+};
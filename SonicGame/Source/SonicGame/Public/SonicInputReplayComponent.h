@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SonicInputReplayComponent.generated.h"
+
+/**
+ * Per-frame values of every axis and action bound on a pawn's input component, and each frame's delta time.
+ * Saved as a small binary file, one float per axis, one bit per action and the delta time for each frame.
+ */
+struct SONICGAME_API FSonicInputRecording
+{
+public:
+	/** Actions beyond this many are not recorded. */
+	static constexpr int32 MaxActions = 32;
+
+	void Reset();
+
+	int32 GetNumFrames() const { return ActionStates.Num(); }
+
+	float GetAxisValue(int32 Frame, int32 Axis) const { return AxisValues[Frame * AxisNames.Num() + Axis]; }
+
+	bool IsActionDown(int32 Frame, int32 Action) const { return (ActionStates[Frame] & (1u << Action)) != 0; }
+
+	bool SaveToFile(const FString& Filename);
+
+	bool LoadFromFile(const FString& Filename);
+
+	/** Where recordings called Name are kept, under Saved/InputRecordings. */
+	static FString GetRecordingPath(const FString& Name);
+
+	friend FArchive& operator<<(FArchive& Ar, FSonicInputRecording& Recording);
+
+public:
+	FString MapName;
+
+	TArray<FName> AxisNames;
+
+	TArray<FName> ActionNames;
+
+	/** NumFrames * AxisNames.Num() values, frame by frame. */
+	TArray<float> AxisValues;
+
+	/** One bitmask of held actions per frame. */
+	TArray<uint32> ActionStates;
+
+	/** Delta time of every recorded frame, replays step through exactly these. */
+	TArray<float> FrameDeltaTimes;
+};
+
+/**
+ * Records the owning pawn's bound input every frame, or plays a recording back by calling the bindings directly.
+ * Recording runs at real speed and keeps each frame's delta time. Replays fix the time step to those recorded deltas
+ * frame by frame, so they go through the level with exactly the steps of the recorded run.
+ * While replaying, frame times and subsystem stats are written to Saved/Profiling/InputReplay as CSV.
+ * Usually added and driven by USonicInputReplaySubsystem.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class SONICGAME_API USonicInputReplayComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	USonicInputReplayComponent();
+
+	bool StartRecording(const FString& Name);
+
+	/** Stops recording and saves what was recorded. */
+	void StopRecording();
+
+	bool StartReplay(const FString& Name);
+
+	/** Stops the replay, hands input back to the player and writes out the frame stats. */
+	void StopReplay();
+
+	bool IsRecording() const { return Mode == EMode::Recording; }
+
+	bool IsReplaying() const { return Mode == EMode::Replaying; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+public:
+	/** Quit the game once a replay finishes, for unattended benchmark runs. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bQuitWhenReplayEnds = false;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	enum class EMode : uint8
+	{
+		None,
+		Recording,
+		Replaying
+	};
+
+	/**
+	 * Makes sure this ticks before the pawn moves, and after the controller has read input when recording or before
+	 * the controller applies rotation input when replaying.
+	 */
+	bool SetupTicking(bool bBeforeController);
+
+	void BeginFixedTimeStep(float DeltaTime);
+
+	void EndFixedTimeStep();
+
+	void RecordFrame();
+
+	void ReplayFrame();
+
+	void LogReplayFrame();
+
+	void WriteReplayStats();
+
+private:
+	EMode Mode = EMode::None;
+
+	FSonicInputRecording Recording;
+
+	FString RecordingName;
+
+	int32 CurrentFrame = 0;
+
+	/** Action states of the previous replayed frame, for sending pressed and released events. */
+	uint32 PreviousActionStates = 0;
+
+	bool bWasUsingFixedTimeStep = false;
+
+	double PreviousFixedDeltaTime = 0.0;
+
+	double LastFrameSeconds = 0.0;
+
+	TArray<float> ReplayFrameTimes;
+
+	TArray<FString> ReplayStatLines;
+};
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "SonicInputReplaySubsystem.generated.h"
+
+class USonicInputReplayComponent;
+
+/**
+ * Starts input recordings and replays on the local player's pawn.
+ *
+ * Console: sonic.input.record <name>, sonic.input.replay <name> [quit], sonic.input.stop
+ * Command line: -SonicInputRecord=<name> or -SonicInputReplay=<name>, plus -SonicInputReplayQuit to exit when the replay ends.
+ * Command line requests start as soon as the player has a pawn, so a replay begins on the same frame the recording did.
+ */
+UCLASS()
+class SONICGAME_API USonicInputReplaySubsystem : public USonicTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	bool StartRecording(const FString& Name);
+
+	bool StartReplay(const FString& Name, bool bQuitWhenDone);
+
+	/** Stops whatever recording or replay is running. */
+	void Stop();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+private:
+	/** Finds the replay component on the local player's pawn, adding one if needed. */
+	USonicInputReplayComponent* GetReplayComponent() const;
+
+	/** Recording from the command line, waiting for the player's pawn. */
+	FString PendingRecordName;
+
+	/** Replay from the command line, waiting for the player's pawn. */
+	FString PendingReplayName;
+
+	bool bPendingReplayQuit = false;
+};
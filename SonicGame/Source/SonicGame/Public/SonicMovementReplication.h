@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/CharacterMovementReplication.h"
+#include "SonicMovementReplication.generated.h"
+
+class AGrindRail;
+
+/** Where a homing attack is at, carried in saved moves and corrections like the movement mode. */
+UENUM(BlueprintType)
+enum class ESonicHomingPhase : uint8
+{
+	/** Not homing. */
+	None,
+
+	/** Flying at the target in the homing movement mode. */
+	Seeking,
+
+	/** Bouncing up off an enemy that was hit, until landing. */
+	Rebound,
+
+	/** Dashing forward without a target, until landing. */
+	AirDash,
+};
+
+/**
+ * Saved move of USonicMovementComponent. Carries the rail jump and homing requests as compressed flags,
+ * and the rail and homing state the move started with, so the server and replays start grinding where the client did.
+ */
+class FSavedMove_Sonic : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	enum ESonicCompressedFlags
+	{
+		FLAG_RailJump	= FLAG_Custom_0,
+		FLAG_Homing		= FLAG_Custom_1,
+	};
+
+	FSavedMove_Sonic();
+
+	virtual void Clear() override;
+
+	virtual uint8 GetCompressedFlags() const override;
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+
+	virtual void PrepMoveFor(ACharacter* C) override;
+
+	uint32 bWantsRailJump : 1;
+
+	uint32 bWantsHoming : 1;
+
+	/** Target of a homing request, null for an air dash. */
+	TWeakObjectPtr<AActor> RequestedHomingTarget;
+
+	/** Rail being ground on at the start of the move. */
+	TWeakObjectPtr<AGrindRail> GrindRail;
+
+	float RailDistance = 0.0f;
+
+	bool bBackwardsGrind = false;
+
+	TWeakObjectPtr<AActor> HomingTarget;
+
+	ESonicHomingPhase HomingPhase = ESonicHomingPhase::None;
+};
+
+class FNetworkPredictionData_Client_Sonic : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Sonic(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/** Move sent to the server: the flags of FSavedMove_Sonic plus the homing target and the rail the move started on. */
+struct FSonicNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+
+	AActor* RequestedHomingTarget = nullptr;
+
+	/** Null while not grinding, the rest is only sent with a rail. */
+	AGrindRail* GrindRail = nullptr;
+
+	/** Sent to a quarter centimetre, like FSonicRepRailMovement. */
+	float RailDistance = 0.0f;
+
+	bool bBackwardsGrind = false;
+};
+
+struct FSonicNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FSonicNetworkMoveDataContainer();
+
+	FSonicNetworkMoveData SonicMoveData[3];
+};
+
+/** Server response that also carries the rail and homing state in corrections, so replays start from the server's. */
+struct FSonicMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	typedef FCharacterMoveResponseDataContainer Super;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+	AGrindRail* GrindRail = nullptr;
+
+	float RailDistance = 0.0f;
+
+	bool bBackwardsGrind = false;
+
+	AActor* HomingTarget = nullptr;
+
+	ESonicHomingPhase HomingPhase = ESonicHomingPhase::None;
+};
+
+/**
+ * Movement of a grinding character sent to simulated proxies instead of FRepMovement, which they rebuild the
+ * transform from along the rail. The rail goes by its net GUID, the distance to a quarter centimetre and the speed
+ * to a centimetre per second. sonic.net.bandwidth measures what it sends against FRepMovement.
+ */
+USTRUCT()
+struct FSonicRepRailMovement
+{
+	GENERATED_BODY()
+
+	/** Null when not grinding, the rest is only sent with a rail. */
+	UPROPERTY()
+	TObjectPtr<AGrindRail> Rail = nullptr;
+
+	UPROPERTY()
+	float Distance = 0.0f;
+
+	UPROPERTY()
+	float Speed = 0.0f;
+
+	UPROPERTY()
+	bool bBackwards = false;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSonicRepRailMovement> : public TStructOpsTypeTraitsBase2<FSonicRepRailMovement>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
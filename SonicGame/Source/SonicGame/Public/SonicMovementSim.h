@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * World-free versions of the movement and grinding math.
+ * Nothing in here touches actors, components or UWorld, so it can be driven from
+ * benchmarks and tests with plain structs. USonicMovementComponent and
+ * ASonicGameCharacter call into it for the real thing.
+ */
+namespace SonicMovementSim
+{
+	/** Everything CalcVelocity reads from the movement component. */
+	struct FVelocityParams
+	{
+		float DeltaTime = 0.0f;
+
+		float Friction = 0.0f;
+
+		float BrakingFriction = 0.0f;
+
+		float BrakingFrictionFactor = 2.0f;
+
+		float BrakingDeceleration = 0.0f;
+
+		float BrakingSubStepTime = 1.0f / 33.0f;
+
+		/** Max speed after analog input and requested moves have been applied. */
+		float MaxSpeed = 0.0f;
+
+		bool bUseSeparateBrakingFriction = false;
+
+		bool bFluid = false;
+
+		/** Input acceleration. */
+		FVector Acceleration = FVector::ZeroVector;
+
+		/** Acceleration requested by path following. */
+		FVector RequestedAcceleration = FVector::ZeroVector;
+
+		bool bZeroRequestedAcceleration = true;
+	};
+
+	/** One sample of a rail spline at the grinder's current distance, in world space. */
+	struct FRailSample
+	{
+		FVector Location = FVector::ZeroVector;
+
+		FVector Tangent = FVector::ForwardVector;
+
+		FVector Up = FVector::UpVector;
+
+		float Roll = 0.0f;
+	};
+
+	struct FRailParams
+	{
+		float DeltaTime = 0.0f;
+
+		float MaxRailSpeed = 0.0f;
+
+		/** How much the rail's pitch speeds the grinder up or slows it down. */
+		float RailAccelerationMultiplier = 0.0f;
+
+		/** Height of the grinder above the rail. */
+		float RailOffset = 0.0f;
+
+		/** Upwards launch speed of a rail jump, scaled by the rail's up vector. Used by GetRailJumpVelocity. */
+		float RailJumpHeight = 0.0f;
+	};
+
+	struct FRailState
+	{
+		/** Distance along the rail. */
+		float Distance = 0.0f;
+
+		/** Grinding against the direction of the spline. */
+		bool bBackwards = false;
+
+		FVector Velocity = FVector::ZeroVector;
+
+		FVector Location = FVector::ZeroVector;
+
+		FRotator Rotation = FRotator::ZeroRotator;
+	};
+
+	enum class ERailEndResult : uint8
+	{
+		/** Still between the ends of the rail. */
+		OnRail,
+
+		/** Went past an end of a closed loop and was moved to the other end. */
+		Wrapped,
+
+		/** Went past an end of an open rail. */
+		Exited
+	};
+
+	/** Ground velocity update: braking, turning friction, fluid friction and acceleration. */
+	SONICGAME_API void CalcVelocity(const FVelocityParams& Params, FVector& Velocity);
+
+	/** Same as UCharacterMovementComponent::ApplyVelocityBraking. */
+	SONICGAME_API void ApplyVelocityBraking(float DeltaTime, float Friction, float BrakingFrictionFactor, float BrakingDeceleration, float BrakingSubStepTime, FVector& Velocity);
+
+	/**
+	 * Moves a grinder one step along a rail.
+	 * Updates velocity from the rail's direction and slope, places the grinder on the sample
+	 * and advances its distance. State.Rotation is read as last frame's rotation before being replaced.
+	 * State.Velocity comes out pointing the way the grinder travels along the rail.
+	 */
+	SONICGAME_API void StepRail(const FRailSample& Sample, const FRailParams& Params, FRailState& State);
+
+	/** Distance along the rail StepRail covers per second at Speed, facing Forward. Climbing covers less than descending. */
+	SONICGAME_API float GetRailDistanceRate(float Speed, const FVector& Forward);
+
+	/** Launch velocity of a jump off a rail: the grinder's velocity along the ground, plus RailJumpHeight scaled by the rail's up vector. */
+	SONICGAME_API FVector GetRailJumpVelocity(const FVector& RailVelocity, const FVector& RailUp, const FRailParams& Params);
+
+	/** Works out whether Distance has gone past an end of the rail, wrapping it on closed loops. */
+	SONICGAME_API ERailEndResult ResolveRailEnd(float RailLength, bool bClosedLoop, FRailState& State);
+
+	/** Moves Current towards Target by at most MaxDistanceDelta. */
+	SONICGAME_API FVector MoveTowards(const FVector& Current, const FVector& Target, float MaxDistanceDelta);
+}
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Gameplay systems with their own frame budget in the sonic.perf overlay. */
+enum class ESonicPerfCategory : uint8
+{
+	RailDetection,
+	Grinding,
+	Homing,
+	ProjectionSpawning,
+	Num
+};
+
+#if !UE_BUILD_SHIPPING
+
+class APlayerController;
+class UCanvas;
+
+/**
+ * Rolling per-frame game thread time of each ESonicPerfCategory, for testers to spot budget overruns while playing.
+ * Turned on and off with the sonic.perf console command, which also shows an overlay. Costs nothing but a branch while off.
+ * Budgets are set in milliseconds with the sonic.perf.Budget.* console variables.
+ * Not compiled into Shipping builds.
+ */
+class SONICGAME_API FSonicPerfTracker
+{
+public:
+	struct FCategoryStats
+	{
+		float P50Ms = 0.0f;
+
+		float P95Ms = 0.0f;
+
+		float P99Ms = 0.0f;
+
+		float MaxMs = 0.0f;
+
+		float BudgetMs = 0.0f;
+
+		/** Frames in the history that went over budget. */
+		int32 NumFramesOverBudget = 0;
+
+		int32 NumFrames = 0;
+
+		/** True when p95 is over budget, i.e. the overrun isn't a one-off hitch. */
+		bool bOverBudget = false;
+	};
+
+	static FSonicPerfTracker& Get();
+
+	bool IsEnabled() const { return bEnabled; }
+
+	/** Starts or stops collecting timings and showing the overlay. */
+	void SetEnabled(bool bInEnabled);
+
+	void Reset();
+
+	/** Adds time spent in Category to the current frame. */
+	void AddTime(ESonicPerfCategory Category, uint64 Cycles) { FrameCycles[(int32)Category] += Cycles; }
+
+	FCategoryStats GetStats(ESonicPerfCategory Category) const;
+
+	/** Writes the stats of every category to the log. */
+	void Dump() const;
+
+	static const TCHAR* GetCategoryName(ESonicPerfCategory Category);
+
+	static float GetBudgetMs(ESonicPerfCategory Category);
+
+private:
+	void OnEndFrame();
+
+	void Draw(UCanvas* Canvas, APlayerController* PlayerController);
+
+	void UpdateOverlayLines();
+
+private:
+	static constexpr int32 NumCategories = (int32)ESonicPerfCategory::Num;
+
+	/** Frames the percentiles are taken over, about five seconds at 60 fps. */
+	static constexpr int32 HistoryLength = 300;
+
+	/** Ring buffers of milliseconds per frame, one per category, sharing HistoryHead. */
+	TArray<float> History[NumCategories];
+
+	int32 HistoryHead = 0;
+
+	int32 HistoryNum = 0;
+
+	uint64 FrameCycles[NumCategories] = {};
+
+	/** Sorting space for the percentiles. */
+	mutable TArray<float> SortedTimes;
+
+	/** Overlay text, rebuilt a few times a second instead of every frame. */
+	TArray<TPair<FString, FColor>> OverlayLines;
+
+	double LastOverlayUpdateTime = 0.0;
+
+	bool bEnabled = false;
+
+	FDelegateHandle EndFrameHandle;
+
+	FDelegateHandle DrawHandle;
+};
+
+/** Adds the game thread time spent in a scope to a category, minus time spent in nested perf scopes. */
+class SONICGAME_API FSonicPerfScope
+{
+public:
+	explicit FSonicPerfScope(ESonicPerfCategory InCategory);
+
+	~FSonicPerfScope();
+
+private:
+	FSonicPerfScope* Parent = nullptr;
+
+	uint64 StartCycles = 0;
+
+	ESonicPerfCategory Category;
+
+	bool bActive = false;
+};
+
+#define SONIC_PERF_SCOPE(Category) FSonicPerfScope ANONYMOUS_VARIABLE(SonicPerfScope_)(ESonicPerfCategory::Category)
+
+#else
+
+#define SONIC_PERF_SCOPE(Category)
+
+#endif
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "SonicActorRegistry.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "SonicSignificanceSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+/** How much an actor matters to the player right now, most significant first. */
+UENUM(BlueprintType)
+enum class ESonicSignificance : uint8
+{
+	/** Animates and ticks every frame. */
+	High,
+
+	/** Animates and ticks at a reduced rate. */
+	Medium,
+
+	/** Animates at a low rate and only while rendered. */
+	Low,
+
+	/** Meshes deactivated and the actor ticks rarely. */
+	Dormant,
+};
+
+/**
+ * Ranks registered actors by distance to the player's view, counting actors outside the view as further away,
+ * and sorts them into significance buckets. The bucket of an actor sets how often its skeletal meshes animate,
+ * how often the actor ticks and whether its meshes are active at all.
+ * Bucket sizes and distances are set with the sonic.Significance.* console variables.
+ */
+UCLASS()
+class SONICGAME_API USonicSignificanceSubsystem : public USonicTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Starts managing Actor and the skeletal meshes it has now. Actors start out High. */
+	void RegisterActor(AActor* Actor);
+
+	/** Stops managing Actor and gives its meshes and tick back their original settings. */
+	void UnregisterActor(AActor* Actor);
+
+	/** Bucket Actor was put in by the last update, High if it isn't registered. */
+	ESonicSignificance GetSignificance(const AActor* Actor) const;
+
+	/** Ranks every registered actor against a view and applies the settings of any actor whose bucket changed. */
+	void UpdateSignificance(const FVector& ViewLocation, const FVector& ViewDirection);
+
+	int32 GetNumRegisteredActors() const { return Entries.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	virtual void Deinitialize() override;
+
+private:
+	/** A managed skeletal mesh and the settings it had before it was managed. */
+	struct FManagedMesh
+	{
+		TWeakObjectPtr<USkeletalMeshComponent> Mesh;
+
+		float TickInterval = 0.0f;
+
+		EVisibilityBasedAnimTickOption VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+
+		bool bWasActive = true;
+	};
+
+	struct FSignificanceEntry
+	{
+		TArray<FManagedMesh> Meshes;
+
+		/** Actor tick interval before the actor was managed. */
+		float ActorTickInterval = 0.0f;
+
+		ESonicSignificance Significance = ESonicSignificance::High;
+
+		/** Distance to the view, scaled up if the actor is out of view. Entries are ranked by it. */
+		float Score = 0.0f;
+	};
+
+	void ApplySignificance(int32 EntryIndex, ESonicSignificance Significance);
+
+	/** Registered actors, Entries runs parallel to it. */
+	TSonicActorRegistry<AActor> Actors;
+
+	TArray<FSignificanceEntry> Entries;
+
+	/** Entry indices in rank order, kept to avoid reallocating every update. */
+	TArray<int32> RankedEntries;
+
+	float TimeSinceUpdate = TNumericLimits<float>::Max();
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "WorldCollision.h"
+#include "SonicSpringArmComponent.generated.h"
+
+/**
+ * Spring arm whose collision test never blocks the game thread.
+ * The arm is swept with the async trace API and the result is read when it lands on a later frame. Each sweep is made
+ * where the arm will be by the time its result is still in use, going by the owner's velocity, so a fast character
+ * doesn't carry the camera into geometry the last result didn't know about. The arm length eases towards the
+ * latest result, pulling in quickly and letting out slowly.
+ * Sweeps are made more often the faster the owner moves, see ProbeRateAtRest and ProbeRateAtMaxSpeed.
+ */
+UCLASS(ClassGroup=Camera, meta=(BlueprintSpawnableComponent))
+class SONICGAME_API USonicSpringArmComponent : public USpringArmComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Collision sweeps per second while the owner is standing still. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1", editcondition = "bDoCollisionTest"))
+	float ProbeRateAtRest = 15.0f;
+
+	/** Collision sweeps per second at ProbeRateMaxSpeed and above. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1", editcondition = "bDoCollisionTest"))
+	float ProbeRateAtMaxSpeed = 60.0f;
+
+	/** Owner speed the sweep rate reaches ProbeRateAtMaxSpeed at. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1", ForceUnits = "cm/s", editcondition = "bDoCollisionTest"))
+	float ProbeRateMaxSpeed = 3000.0f;
+
+	/** Seconds to close half the distance when the arm has to get shorter. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.001", ForceUnits = "s", editcondition = "bDoCollisionTest"))
+	float PullInHalfLife = 0.02f;
+
+	/** Seconds to close half the distance when the arm can get longer again. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.001", ForceUnits = "s", editcondition = "bDoCollisionTest"))
+	float PushOutHalfLife = 0.2f;
+
+	/** Fraction of the full arm length the camera is at now. */
+	float GetArmFraction() const { return ArmFraction; }
+
+protected:
+	virtual void UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime) override;
+
+private:
+	/** Issues a sweep of the arm from ArmOrigin to DesiredLocation if it is time for one. */
+	void IssueProbe(const FVector& ArmOrigin, const FVector& DesiredLocation, float DeltaTime);
+
+	void OnProbeCompleted(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	/** Sweep in flight, invalid when there is none. */
+	FTraceHandle PendingProbe;
+
+	FTraceDelegate ProbeDelegate;
+
+	float TimeSinceProbe = TNumericLimits<float>::Max();
+
+	/** Fraction of the arm that was clear in the latest sweep result. */
+	float ProbedArmFraction = 1.0f;
+
+	float ArmFraction = 1.0f;
+};
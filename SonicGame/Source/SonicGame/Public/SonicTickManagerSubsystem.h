@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonicWorldSubsystem.h"
+#include "SonicActorRegistry.h"
+#include "SonicTickManagerSubsystem.generated.h"
+
+class ISonicBatchTickable;
+
+/**
+ * Updates stage actors that have no tick function of their own.
+ * Distances to the player are worked out for every registered actor in one pass,
+ * then actors implementing ISonicBatchTickable get their BatchTick.
+ */
+UCLASS()
+class SONICGAME_API USonicTickManagerSubsystem : public USonicTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterActor(AActor* Actor);
+
+	void UnregisterActor(AActor* Actor);
+
+	int32 GetNumRegisteredActors() const { return Actors.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	virtual void Deinitialize() override;
+
+private:
+	/** Registered actors, the arrays below run parallel to it. */
+	TSonicActorRegistry<AActor> Actors;
+
+	/** Null for actors that only registered to skip their tick. */
+	TArray<ISonicBatchTickable*> BatchTickables;
+
+	TArray<float> DistancesToPlayer;
+
+	bool bIsBatchTicking = false;
+};
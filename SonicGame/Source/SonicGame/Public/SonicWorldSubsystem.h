@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SonicWorldSubsystem.generated.h"
+
+/** World subsystem that only exists in game and PIE worlds, not in editor previews or the editor world. */
+UCLASS(Abstract)
+class SONICGAME_API USonicWorldSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
+
+/** Tickable world subsystem that only exists in game and PIE worlds. */
+UCLASS(Abstract)
+class SONICGAME_API USonicTickableWorldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
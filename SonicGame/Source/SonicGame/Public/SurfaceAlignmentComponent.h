@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SurfaceAlignmentComponent.generated.h"
+
+class UCharacterMovementComponent;
+
+/**
+ * Turns a character's capsule to stand on the surface under it: up along the floor normal while walking, upright in the air.
+ * The target is worked out as a quaternion and slerped towards, so loops and walls don't flip at the top like Euler angles do.
+ * Doesn't tick, the owner calls AlignToSurface from its own tick.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class SONICGAME_API USurfaceAlignmentComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:	
+	// Sets default values for this component's properties
+	USurfaceAlignmentComponent();
+
+	/**
+	 * Moves the updated component of the owner's character movement towards GetTargetRotation.
+	 * Sets the rotation at most once, and not at all when already within AlignmentTolerance.
+	 * Does nothing in movement modes other than walking and falling, those set their own rotation.
+	 */
+	void AlignToSurface(float DeltaTime);
+
+	/** Orientation AlignToSurface turns towards in the current movement state. */
+	FQuat GetTargetRotation() const;
+
+protected:
+	virtual void OnRegister() override;
+
+public:
+	/** Seconds to close half of the remaining angle to the target, whatever the frame rate. */
+	UPROPERTY(Category = "Surface Alignment", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.001"))
+	float AlignmentHalfLife = 0.07f;
+
+	/** No rotation is set while within this many degrees of the target. */
+	UPROPERTY(Category = "Surface Alignment", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+	float AlignmentTolerance = 0.5f;
+
+	/**
+	 * Face along the velocity on the ground, so the heading coming out of a loop doesn't depend on the one going in.
+	 * Off by default, the heading is otherwise left to the character. Turns the character around when the velocity reverses.
+	 */
+	UPROPERTY(Category = "Surface Alignment", EditAnywhere, BlueprintReadWrite)
+	bool bFaceVelocity = false;
+
+	/** Slowest ground speed bFaceVelocity applies at. */
+	UPROPERTY(Category = "Surface Alignment", EditAnywhere, BlueprintReadWrite)
+	float MinFacingSpeed = 100.0f;
+
+	/**
+	 * Seconds of travel ahead to read the floor normal from, when the owner's movement probes the ground ahead.
+	 * Starts the turn into a slope or loop before reaching it, which hides the lag from AlignmentHalfLife.
+	 */
+	UPROPERTY(Category = "Surface Alignment", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0", ForceUnits = "s"))
+	float FloorLeadTime = 0.05f;
+
+private:
+	UPROPERTY()
+	TObjectPtr<UCharacterMovementComponent> CharacterMovement;
+};
@@ -2,7 +2,10 @@
 
 
 #include "SonicCharacterBase.h"
+#include "SonicGame.h"
 #include "NinjaCharacterMovementComponent.h"
+#include "SurfaceAlignmentComponent.h"
+#include "SonicSpringArmComponent.h"
 
 #include "GameFramework/SpringArmComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -10,6 +13,8 @@
 
 #include "Kismet/KismetMathLibrary.h"
 
+DECLARE_CYCLE_STAT(TEXT("Reset Capsule Rotation"), STAT_SonicResetCapsuleRotation, STATGROUP_SonicGame);
+
 ASonicCharacterBase::ASonicCharacterBase(const FObjectInitializer& ObjectInitializer)
 	:Super(ObjectInitializer.SetDefaultSubobjectClass<UNinjaCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
@@ -23,7 +28,7 @@ ASonicCharacterBase::ASonicCharacterBase(const FObjectInitializer& ObjectInitial
 	bUseControllerRotationRoll = false;
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+	CameraBoom = CreateDefaultSubobject<USonicSpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
 	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
 	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
@@ -32,18 +37,17 @@ ASonicCharacterBase::ASonicCharacterBase(const FObjectInitializer& ObjectInitial
 	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+
+	SurfaceAlignment = CreateDefaultSubobject<USurfaceAlignmentComponent>(TEXT("SurfaceAlignment"));
 }
 
 void ASonicCharacterBase::ResetCapsuleRotation(float DeltaTime)
 {
-	FVector forward = GetActorForwardVector();// * moveForward;
-	FVector right = GetActorRightVector(); //* moveRight;
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicResetCapsuleRotation);
 
+	// The Ninja movement component aligns to the floor itself on the ground
 	if (GetNinjaCharacterMovement()->IsFalling())
-	{
-		UCapsuleComponent* capsule = GetCapsuleComponent();
-		capsule->SetWorldRotation(FMath::RInterpTo(capsule->GetComponentRotation(), FRotator(0.0f, capsule->GetComponentRotation().Yaw, 0.0f), DeltaTime, 10.0f));
-	}
+		SurfaceAlignment->AlignToSurface(DeltaTime);
 }
 
 void ASonicCharacterBase::BoostStart()
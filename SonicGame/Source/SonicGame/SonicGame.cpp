@@ -3,5 +3,12 @@
 #include "SonicGame.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogSonicGame);
+
+DEFINE_STAT(STAT_SonicEnemyTicksAvoided);
+DEFINE_STAT(STAT_SonicTracesIssued);
+DEFINE_STAT(STAT_SonicSplineEvaluations);
+
+UE_TRACE_CHANNEL_DEFINE(SonicGameChannel);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, SonicGame, "SonicGame" );
- 
\ No newline at end of file
@@ -3,3 +3,65 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogSonicGame, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("SonicGame"), STATGROUP_SonicGame, STATCAT_Advanced);
+
+/** Unreal Insights channel for gameplay CPU scopes. Enable with -trace=cpu,SonicGame. */
+UE_TRACE_CHANNEL_EXTERN(SonicGameChannel, SONICGAME_API);
+
+/** Cycle stat and Insights CPU event for one scope, held together so SONIC_SCOPE_CYCLE_COUNTER is a single declaration. */
+class FSonicScopeCycleCounter
+{
+public:
+	FSonicScopeCycleCounter(TStatId StatId, uint32& SpecId, const TCHAR* EventName, const ANSICHAR* File, uint32 Line)
+		: CycleCounter(StatId)
+#if CPUPROFILERTRACE_ENABLED
+		, TraceScope(GetSpecId(SpecId, EventName, File, Line), SonicGameChannel)
+#endif
+	{
+	}
+
+private:
+#if CPUPROFILERTRACE_ENABLED
+	/** Registers the event name with the trace the first time the scope is entered with the channel on. */
+	static uint32 GetSpecId(uint32& SpecId, const TCHAR* EventName, const ANSICHAR* File, uint32 Line)
+	{
+		if (SpecId == 0 && bool(SonicGameChannel | CpuChannel))
+		{
+			SpecId = FCpuProfilerTrace::OutputEventType(EventName, File, Line);
+		}
+		return SpecId;
+	}
+#endif
+
+	FScopeCycleCounter CycleCounter;
+
+#if CPUPROFILERTRACE_ENABLED
+	FCpuProfilerTrace::FEventScope TraceScope;
+#endif
+};
+
+/**
+ * Times the enclosing scope as a cycle stat for "stat SonicGame", which also counts calls,
+ * and as a CPU event on SonicGameChannel for Unreal Insights.
+ * Expands to one declaration, the lambda gives every call site its own event id.
+ */
+#define SONIC_SCOPE_CYCLE_COUNTER(Stat) \
+	FSonicScopeCycleCounter ANONYMOUS_VARIABLE(SonicScopeCycleCounter_)(GET_STATID(Stat), []() -> uint32& { static uint32 SpecId = 0; return SpecId; }(), TEXT(#Stat), __FILE__, __LINE__)
+
+/**
+ * Enemies that are updated by USonicTickManagerSubsystem instead of their own tick function.
+ * Rails and projections also run without a tick, but don't register with the tick manager and aren't counted.
+ */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Enemy Ticks Avoided"), STAT_SonicEnemyTicksAvoided, STATGROUP_SonicGame, SONICGAME_API);
+
+/** Collision traces and sweeps issued by gameplay code this frame. */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces Issued"), STAT_SonicTracesIssued, STATGROUP_SonicGame, SONICGAME_API);
+
+/** Rail spline evaluations this frame. A fused rail frame counts as one. */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Spline Evaluations"), STAT_SonicSplineEvaluations, STATGROUP_SonicGame, SONICGAME_API);
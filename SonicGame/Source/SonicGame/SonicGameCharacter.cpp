@@ -1,6 +1,8 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "SonicGameCharacter.h"
+#include "SonicGame.h"
+#include "SonicPerfTracker.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -13,16 +15,38 @@
 #include "Math/UnrealMathUtility.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
 
 #include "Enemy.h"
 #include "GrindRail.h"
+#include "GrindRailSubsystem.h"
+#include "HomingTargetSubsystem.h"
+#include "SurfaceAlignmentComponent.h"
+#include "SonicSpringArmComponent.h"
 
 #include "SonicMovementComponent.h"
+#include "SonicMovementSim.h"
+
+DECLARE_CYCLE_STAT(TEXT("Detect Grind Rail"), STAT_SonicDetectGrindRail, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Detect Side Rail"), STAT_SonicDetectSideRail, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Grind On Rail"), STAT_SonicGrindOnRail, STATGROUP_SonicGame);
 
 //////////////////////////////////////////////////////////////////////////
 // ASonicGameCharacter
 
-ASonicGameCharacter::ASonicGameCharacter()
+static TAutoConsoleVariable<bool> CVarSonicRailRelativeMovement(
+	TEXT("sonic.net.RailRelativeMovement"),
+	true,
+	TEXT("While grinding, sends simulated proxies the rail, distance and speed instead of the full replicated movement."));
+
+/** Rails are looked for around Sonic's feet, this far below the actor location. */
+static const float RailDetectionFeetOffset = 60.0f;
+
+static const float RailDetectionRadius = 40.0f;
+
+ASonicGameCharacter::ASonicGameCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USonicMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// set our turn rates for input
 	BaseTurnRate = 45.f;
@@ -36,7 +60,7 @@ ASonicGameCharacter::ASonicGameCharacter()
 	bUseCharacterVectors = false;
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+	CameraBoom = CreateDefaultSubobject<USonicSpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
 	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
 	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
@@ -64,6 +88,8 @@ ASonicGameCharacter::ASonicGameCharacter()
 
 	PsyloopPoint = CreateDefaultSubobject<USceneComponent>(TEXT("PsyloopPoint"));
 	PsyloopPoint->SetupAttachment(RootComponent);
+
+	SurfaceAlignment = CreateDefaultSubobject<USurfaceAlignmentComponent>(TEXT("SurfaceAlignment"));
 }
 
 void ASonicGameCharacter::UpdatePhysics(float DeltaTime)
@@ -83,29 +109,21 @@ void ASonicGameCharacter::UpdatePhysics(float DeltaTime)
 		HideHomingIcon();
 		bCanDoHomingAttack = true;
 	}
-	
-	// Are we currently performing a homing attack?
-	if(bIsHoming)
-		DoHomingAttack();
 }
 
 void ASonicGameCharacter::CheckGround(float DeltaTime)
 {
-	FHitResult outHit;
-
-	FVector start = GetActorLocation();
-	FVector end = start + GetActorQuat().GetAxisZ() * -60.0f; // player's current up vector
-
-	FCollisionQueryParams collisionParams;
-	collisionParams.AddIgnoredActor(this->GetOwner());
-
-	//DrawDebugLine(GetWorld(), start, end, FColor::Blue, false, -1.0f, 0, 1);
-	
-	bool isHit = GetWorld()->LineTraceSingleByChannel(outHit, start, end, ECC_Visibility, collisionParams);
-
-	if (isHit)
+	// Read from the movement component's floor instead of tracing again
+	USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+	FSonicFloorSample floorAhead;
+	if (sonicMovement && sonicMovement->GetPredictedFloor(0.0f, floorAhead))
 	{
-		GroundNormal = outHit.Normal;
+		GroundNormal = floorAhead.Normal;
+		bIsGrounded = true;
+	}
+	else if (GetCharacterMovement()->IsMovingOnGround() && GetCharacterMovement()->CurrentFloor.IsWalkableFloor())
+	{
+		GroundNormal = GetCharacterMovement()->CurrentFloor.HitResult.ImpactNormal;
 		bIsGrounded = true;
 	}
 	else
@@ -117,85 +135,91 @@ void ASonicGameCharacter::CheckGround(float DeltaTime)
 
 void ASonicGameCharacter::UpdateRotation(float DeltaTime)
 {
-	//float moveForward = GetInputAxisValue("MoveForward");
-	//float moveRight = GetInputAxisValue("MoveRight");
-
-	FVector forward = GetActorForwardVector();// * moveForward;
-	FVector right = GetActorRightVector(); //* moveRight;
-
+	SurfaceAlignment->AlignToSurface(DeltaTime);
+}
 
-	if (!GetCharacterMovement()->IsFalling())
+void ASonicGameCharacter::OnHomingStarted(AActor* Target)
+{
+	if (Target)
 	{
+		bIsHoming = true;
+		bCanMove = false;
+		return;
+	}
 
-		FHitResult floorHit = GetCharacterMovement()->CurrentFloor.HitResult;
-
-		float f = floorHit.ImpactNormal.Dot(FVector(0.0f, 0.0f, 1.0f));
-		float theta = FMath::RadiansToDegrees(FMath::Acos(f));
+	// Air dash
+	bCanDoHomingAttack = false;
 
-		//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, FString::Printf(TEXT("%f"), theta));
+	if(JumpBallMesh)
+		JumpBallMesh->SetVisibility(true, true);
+	GetMesh()->SetVisibility(false);
+	GetCapsuleComponent()->SetCapsuleHalfHeight(28.0f);
+}
 
-		UCapsuleComponent* capsule = GetCapsuleComponent();
+void ASonicGameCharacter::OnHomingFinished(AActor* Target, bool bReachedTarget)
+{
+	bIsHoming = false;
+	bCanMove = true;
+	bCanDoHomingAttack = true;
 
-		FRotator r = UKismetMathLibrary::MakeRotationFromAxes(capsule->GetForwardVector(), capsule->GetRightVector(), floorHit.ImpactNormal);
-		FRotator r2 = FRotationMatrix::MakeFromYZ(capsule->GetRightVector(), floorHit.ImpactNormal).Rotator();
+	if (HomingTarget == Target)
+		HomingTarget = nullptr;
 
-		FRotator newRot = FRotator(r2.Pitch, capsule->GetComponentRotation().Yaw, r.Roll);
+	// Replicated enemies are destroyed by the server, everyone else destroys their own copy
+	if (bReachedTarget && Cast<AEnemy>(Target) && (HasAuthority() || !Target->GetIsReplicated()))
+		Target->Destroy();
 
-		capsule->SetWorldRotation(FMath::RInterpTo(capsule->GetComponentRotation(), newRot, DeltaTime, 10.0f));
-	}
-	else
-	{
-		UCapsuleComponent* capsule = GetCapsuleComponent();
-		capsule->SetWorldRotation(FMath::RInterpTo(capsule->GetComponentRotation(), FRotator(0.0f, capsule->GetComponentRotation().Yaw, 0.0f), DeltaTime, 10.0f));
-	}
+	HideHomingIcon();
 }
 
-void ASonicGameCharacter::DoHomingAttack()
+bool ASonicGameCharacter::DrivesOwnMovement() const
 {
-	if (HomingTarget)
-	{
-		FVector targetLoc = HomingTarget->GetActorLocation();
+	// Simulated proxies show the server's movement, and the server runs a remote client's moves as they come in
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+		return false;
 
-		if (FVector::Dist(GetActorLocation(), targetLoc) <= MinHomingThreshold)
-		{
-			bIsHoming = false;
-			bCanMove = true;
-			bCanDoHomingAttack = true;
-			GetCharacterMovement()->GravityScale = 1.0f;
-
-			if (Cast<AEnemy>(HomingTarget))
-			{
-				HomingTarget->Destroy();
-				HomingTarget = nullptr;
-
-				LaunchCharacter(FVector(0.0f, 0.0f, 1.0f) * HomingUpForce, false, true);
-			}
-			
-			HideHomingIcon();
+	return !(GetLocalRole() == ROLE_Authority && GetRemoteRole() == ROLE_AutonomousProxy);
+}
 
-			return;
-		}
 
-		FHitResult sweepHit;
-		SetActorLocation(UKismetMathLibrary::VInterpTo(GetActorLocation(), targetLoc, GetWorld()->DeltaTimeSeconds, HomingSpeed), true, &sweepHit);
+void ASonicGameCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-		// Did we hit something before making it to the target?
-		if (sweepHit.bBlockingHit)
-		{
-			bIsHoming = false;
-			bCanMove = true;
-			bCanDoHomingAttack = true;
-			GetCharacterMovement()->GravityScale = 1.0f;
+	DOREPLIFETIME_CONDITION(ASonicGameCharacter, RailMovement, COND_SimulatedOnly);
+}
 
-			HomingTarget = nullptr;
+void ASonicGameCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
 
-			HideHomingIcon();
+	// Rails placed in the level have a net GUID, anything else can't be sent by reference
+	USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+	AGrindRail* grindRail = sonicMovement && sonicMovement->IsGrinding() ? sonicMovement->GetGrindRail() : nullptr;
+	const bool bRailRelative = grindRail && grindRail->IsSupportedForNetworking() && CVarSonicRailRelativeMovement.GetValueOnGameThread();
 
-			return;
-		}
+	// Stays null when not grinding, so it only changes, and is only sent, while on a rail
+	RailMovement.Rail = bRailRelative ? grindRail : nullptr;
+	if (bRailRelative)
+	{
+		RailMovement.Distance = sonicMovement->GetRailDistance();
+		RailMovement.Speed = sonicMovement->Velocity.Size();
+		RailMovement.bBackwards = sonicMovement->IsBackwardsGrind();
 	}
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE_PRIVATE_PROPERTY(AActor, ReplicatedMovement, IsReplicatingMovement() && !bRailRelative);
 }
 
+void ASonicGameCharacter::OnRep_RailMovement()
+{
+	USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+	if (!sonicMovement || GetLocalRole() != ROLE_SimulatedProxy)
+		return;
+
+	// Proxies never run GrindOnRail, but need the rail offset to be placed on the rail
+	sonicMovement->SetGrindingParams(GetRailParams());
+	sonicMovement->ApplyReplicatedRailMovement(RailMovement.Rail, RailMovement.Distance, RailMovement.Speed, RailMovement.bBackwards);
+}
 
 void ASonicGameCharacter::AddVelocity(FVector Force)
 {
@@ -237,31 +261,25 @@ void ASonicGameCharacter::Jump()
 	}
 	else if (!bIsHoming && GetMovementComponent()->IsFalling())
 	{
-		if (HomingTarget && HomingViewAngle <= MinHomingViewAngle)
+		// The movement component starts the attack on the next move, so it's predicted and replayed like any other movement
+		USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+
+		if (sonicMovement && HomingTarget && HomingViewAngle <= MinHomingViewAngle)
 		{
 			bIsHoming = true;
 			bCanMove = false;
-			GetCharacterMovement()->GravityScale = 0.0f;
-			GetCharacterMovement()->StopMovementImmediately();
-
-			SetActorRotation(UKismetMathLibrary::FindLookAtRotation(GetActorLocation(), HomingTarget->GetActorLocation()));
+			sonicMovement->RequestHomingAttack(HomingTarget);
 
 			if(HomingSound)
 				UGameplayStatics::PlaySoundAtLocation(GetWorld(), HomingSound, GetActorLocation());
 		}
-		else if(bCanDoHomingAttack)
+		else if(sonicMovement && bCanDoHomingAttack)
 		{
 			bCanDoHomingAttack = false;
-			GetCharacterMovement()->StopMovementImmediately();
-			LaunchCharacter(GetActorForwardVector() * HomingUpForce * 6.0f, true, false);
+			sonicMovement->RequestHomingAttack(nullptr);
 
 			if (HomingSound)
 				UGameplayStatics::PlaySoundAtLocation(GetWorld(), HomingSound, GetActorLocation());
-
-			if(JumpBallMesh)
-				JumpBallMesh->SetVisibility(true, true);
-			GetMesh()->SetVisibility(false);
-			GetCapsuleComponent()->SetCapsuleHalfHeight(28.0f);
 		}
 		
 	}
@@ -276,99 +294,117 @@ void ASonicGameCharacter::StopJump()
 
 AActor* ASonicGameCharacter::GetNearestHomingTarget(float radius)
 {
-	const FVector start = GetActorLocation();
-	const FVector end = GetActorLocation();
-	
-	TArray<AActor*> IgnoreActors;
-	IgnoreActors.Add(GetOwner());
-
-	TArray<FHitResult> HitArray;
-
-	ETraceTypeQuery TraceChannel = UEngineTypes::ConvertToTraceType(ECC_Pawn);
+	SONIC_PERF_SCOPE(Homing);
 
-	bool hit = UKismetSystemLibrary::SphereTraceMulti(GetWorld(), start, end, radius, TraceChannel, false, IgnoreActors, EDrawDebugTrace::None, HitArray, true);
+	UHomingTargetSubsystem* homingSubsystem = GetWorld()->GetSubsystem<UHomingTargetSubsystem>();
+	if (!homingSubsystem)
+		return nullptr;
 
-	float shortestDistSq = radius * radius;
-	AEnemy* closestEnemy = nullptr;
+	// Only targets registered in the homing hash are considered, the physics scene is never touched
+	HomingCandidateActors.Reset();
+	homingSubsystem->GatherTargetsInRadius(GetActorLocation(), radius, HomingCandidateActors, this);
 
-	// Did sphere trace hit anything?
-	if (hit)
+	HomingCandidates.Reset();
+	for (AActor* candidate : HomingCandidateActors)
 	{
-		// loop through hit results
-		for (FHitResult HitResult : HitArray)
-		{
-			// Validate enemy
-			AEnemy* enemy = Cast<AEnemy>(HitResult.GetActor());
-			if (enemy != nullptr)
-			{
-				float distSq = FVector::DistSquared(GetActorLocation(), enemy->GetActorLocation()); // get squared distance between player and current enemy
-
-				// update closest enemy and distance if current enemy is closer than the previous closest enemy
-				if (distSq < shortestDistSq)
-				{
-					shortestDistSq = distSq;
-					closestEnemy = enemy;
-				}
-			}
-		}
+		HomingCandidates.Add(candidate->GetActorLocation());
 	}
 
-	if (closestEnemy)
+	FHomingScoringParams scoringParams;
+	scoringParams.Origin = GetActorLocation();
+	scoringParams.Forward = GetActorForwardVector();
+	scoringParams.CameraForward = FollowCamera->GetForwardVector();
+	scoringParams.Radius = radius;
+	scoringParams.MinViewCos = FMath::Cos(FMath::DegreesToRadians(MinHomingViewAngle));
+	scoringParams.DistanceWeight = HomingDistanceWeight;
+	scoringParams.FacingWeight = HomingFacingWeight;
+	scoringParams.CameraWeight = HomingCameraWeight;
+
+	// Targets outside the view cone are rejected inside the scoring pass, so a closer enemy behind Sonic can't win
+	float facingCos = -1.0f;
+	const int32 bestIndex = HomingCandidates.FindBest(scoringParams, facingCos);
+	AActor* bestTarget = bestIndex != INDEX_NONE ? HomingCandidateActors[bestIndex] : nullptr;
+
+	if (bestTarget)
 	{
-		//DrawDebugLine(GetWorld(), GetActorLocation(), closestEnemy->GetActorLocation(), FColor::Blue);
-		FVector dir = closestEnemy->GetActorLocation() - GetActorLocation();
-		HomingViewAngle = FVector::DotProduct(GetActorForwardVector(), dir.GetSafeNormal());
-		//HomingViewAngle = FVector::DotProduct(FollowCamera->GetForwardVector(), dir.GetSafeNormal());
-		HomingViewAngle = FMath::RadiansToDegrees(FMath::Acos(HomingViewAngle));
-		//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, FString::Printf(TEXT("%f"), HomingViewAngle));
-
-		if (HomingTarget && HomingTarget != closestEnemy && HomingViewAngle <= MinHomingViewAngle)
+		HomingViewAngle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(facingCos, -1.0f, 1.0f)));
+
+		if (HomingTarget && HomingTarget != bestTarget)
 		{
 			HideHomingIcon();
-			ShowHomingIcon(closestEnemy);
+			ShowHomingIcon(bestTarget);
 		}
 	}
 
-	return closestEnemy;
+	HomingCandidateActors.Reset();
+
+	return bestTarget;
 }
 
 void ASonicGameCharacter::DetectGrindRail()
 {
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicDetectGrindRail);
+	SONIC_PERF_SCOPE(RailDetection);
+
+	// Copies that don't pick their own rails follow the movement component on and off them
+	if (!DrivesOwnMovement())
+	{
+		USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+		bIsGrinding = sonicMovement && sonicMovement->IsGrinding();
+
+		// Simulated proxies only get the rail from RailMovement, and only while rail relative movement is on
+		AGrindRail* movementRail = bIsGrinding ? sonicMovement->GetGrindRail() : nullptr;
+		if (movementRail)
+		{
+			CurrentRail = movementRail->RailSpline;
+			RailStartDistance = sonicMovement->GetRailDistance();
+			bBackwardsGrind = sonicMovement->IsBackwardsGrind();
+
+			// The server still runs the rail with our tuning
+			if (HasAuthority())
+				GrindOnRail(RailStartDistance, CurrentRail);
+		}
+		return;
+	}
+
 	if (bIsGrinding)
 	{
 		GrindOnRail(RailStartDistance, CurrentRail);
 	}
 	else
 	{
-		FVector start = GetActorLocation() - FVector(0.0f, 0.0f, 60.0f);
-		FVector end = GetActorLocation() - FVector(0.0f, 0.0f, 61.0f);
+		// Something else took us off the rail, don't leave the movement component grinding
+		USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+		if (sonicMovement && sonicMovement->IsGrinding())
+			sonicMovement->StopGrinding();
 
-		FHitResult outHit;
-
-		TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypesArray;
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldStatic));
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldDynamic));
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_GameTraceChannel1));
+		UGrindRailSubsystem* railSubsystem = GetWorld()->GetSubsystem<UGrindRailSubsystem>();
+		if (!railSubsystem)
+			return;
 
-		TArray<AActor*> IgnoreActors;
+		// Query the rail index around Sonic's feet instead of sweeping the physics scene
+		FVector feetLocation = GetActorLocation() - FVector(0.0f, 0.0f, RailDetectionFeetOffset);
 
-		bool traceHit = UKismetSystemLibrary::SphereTraceSingleForObjects(GetWorld(), start, end, 40.0f, ObjectTypesArray, false, IgnoreActors, EDrawDebugTrace::None, outHit, true);
+		FGrindRailQueryResult railHit;
+		const bool bFoundRail = railSubsystem->FindClosestRail(feetLocation, RailDetectionRadius, railHit);
 
-		if (traceHit)
+		if (bFoundRail)
 		{
-			AGrindRail* hitActor = Cast<AGrindRail>(outHit.GetActor());
+			AGrindRail* hitActor = railHit.Rail;
 			if (hitActor)
 			{
-				RailCollisionPoint = hitActor->RailSpline->FindLocationClosestToWorldLocation(GetActorLocation(), ESplineCoordinateSpace::World);
-				ClosestRailPointDistance = GetClosestDistanceToLocation(hitActor->RailSpline, RailCollisionPoint, 0.5f);
+				RailCollisionPoint = railHit.Location;
+				ClosestRailPointDistance = railHit.Distance;
+
+				const FRailFrame railFrame = hitActor->GetRailFrameAtDistance(ClosestRailPointDistance);
 
-				FVector railTangent = hitActor->RailSpline->GetTangentAtDistanceAlongSpline(ClosestRailPointDistance, ESplineCoordinateSpace::World).GetSafeNormal();
+				FVector railTangent = railFrame.Tangent.GetSafeNormal();
 				float grindDirection = FVector::DotProduct(GetActorForwardVector(), railTangent);
 
 				bBackwardsGrind = grindDirection < 0.0f;
 
-				FVector railLocation = hitActor->RailSpline->GetLocationAtDistanceAlongSpline(ClosestRailPointDistance, ESplineCoordinateSpace::World) + (GetActorUpVector() * RailOffset);
-				FRotator railRotation = hitActor->RailSpline->GetRotationAtDistanceAlongSpline(ClosestRailPointDistance, ESplineCoordinateSpace::World);
+				FVector railLocation = railFrame.Location + (GetActorUpVector() * RailOffset);
+				FRotator railRotation = railFrame.Rotation.Rotator();
 
 				SetActorLocationAndRotation(railLocation, railRotation);
 
@@ -376,17 +412,14 @@ void ASonicGameCharacter::DetectGrindRail()
 				CurrentRail = hitActor->RailSpline;
 				bIsGrinding = true;
 
-				GetCharacterMovement()->GravityScale = 0.0f;
+				hitActor->EnterRail(this);
 
-				if (GetVelocity().Length() < hitActor->MinRailSpeed)
+				// The movement component moves us along the rail from here on, starting at the rail's minimum speed
+				if (USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement()))
 				{
-					FVector minVelocity = hitActor->RailSpline->GetTangentAtDistanceAlongSpline(RailStartDistance, ESplineCoordinateSpace::World).GetSafeNormal() * hitActor->MinRailSpeed;
-					SetVelocity(GetRailVelocityInDirection(minVelocity, bBackwardsGrind), true, true, false);
+					sonicMovement->StartGrinding(hitActor, RailStartDistance, bBackwardsGrind);
+					GrindOnRail(RailStartDistance, CurrentRail);
 				}
-				hitActor->EnterRail(this);
-
-				GetCharacterMovement()->SetMovementMode(MOVE_Flying);
-				Cast<USonicMovementComponent>(GetMovementComponent())->bIgnoreGrindingDecel = false;
 			}
 		}
 	}
@@ -394,60 +427,39 @@ void ASonicGameCharacter::DetectGrindRail()
 
 void ASonicGameCharacter::DetectSideRail()
 {
-	if (bIsGrinding)
-	{
-		//Right Rail Detection
-		FVector rightStart = (GetActorLocation() - FVector(0.0f, 0.0f, 60.0f)) + (GetActorRightVector() * 60.0f);
-		FVector rightEnd = rightStart + (GetActorRightVector() * 300.0f);
-
-		//Left Rail Detection
-		FVector leftStart = (GetActorLocation() - FVector(0.0f, 0.0f, 60.0f)) + (GetActorRightVector() * -60.0f);
-		FVector leftEnd = leftStart + (GetActorRightVector() * -300.0f);
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicDetectSideRail);
+	SONIC_PERF_SCOPE(RailDetection);
 
-		FHitResult rightOutHit;
-		FHitResult leftOutHit;
+	AGrindRail* currentGrindRail = CurrentRail ? Cast<AGrindRail>(CurrentRail->GetOwner()) : nullptr;
 
-		TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypesArray;
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldStatic));
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldDynamic));
-		ObjectTypesArray.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_GameTraceChannel1));
-
-		TArray<AActor*> IgnoreActors;
-
-		bool rightHit = UKismetSystemLibrary::SphereTraceSingleForObjects(GetWorld(), rightStart, rightEnd, 40.0f, ObjectTypesArray, false, IgnoreActors, EDrawDebugTrace::None, rightOutHit, true);
-		bool leftHit = UKismetSystemLibrary::SphereTraceSingleForObjects(GetWorld(), leftStart, leftEnd, 40.0f, ObjectTypesArray, false, IgnoreActors, EDrawDebugTrace::None, leftOutHit, true);
-		
+	if (bIsGrinding && currentGrindRail)
+	{
+		// The rail's neighbour table is relative to the spline direction, so left and right swap when grinding backwards
+		float rightTargetDistance = 0.0f;
+		float leftTargetDistance = 0.0f;
+		AGrindRail* rightGrindRail = currentGrindRail->FindSideRail(RailStartDistance, !bBackwardsGrind, rightTargetDistance);
+		AGrindRail* leftGrindRail = currentGrindRail->FindSideRail(RailStartDistance, bBackwardsGrind, leftTargetDistance);
 
-		if (rightHit)
+		if (rightGrindRail)
 		{
-			AGrindRail* rightGrindRail = Cast<AGrindRail>(rightOutHit.GetActor());
-			if (rightGrindRail)
-			{
-				if (rightGrindRail->RailSpline != CurrentRail)
-				{
-					RightRailCollisionPoint = rightOutHit.ImpactPoint;
-					RightRail = rightGrindRail->RailSpline;
-					RightRailTargetPoint = RightRailCollisionPoint - GetVelocity();
-				}
-			}
+			RightRail = rightGrindRail->RailSpline;
+			RightRailTargetDistance = rightTargetDistance;
+			INC_DWORD_STAT(STAT_SonicSplineEvaluations);
+			RightRailTargetPoint = RightRail->GetLocationAtDistanceAlongSpline(rightTargetDistance, ESplineCoordinateSpace::World);
+			RightRailCollisionPoint = RightRailTargetPoint;
 		}
 		else
 		{
 			RightRail = nullptr;
 		}
 
-		if (leftHit)
+		if (leftGrindRail)
 		{
-			AGrindRail* leftGrindRail = Cast<AGrindRail>(leftOutHit.GetActor());
-			if (leftGrindRail)
-			{
-				if (leftGrindRail->RailSpline != CurrentRail)
-				{
-					LeftRailCollisionPoint = leftOutHit.ImpactPoint;
-					LeftRail = leftGrindRail->RailSpline;
-					LeftRailTargetPoint = LeftRailCollisionPoint - GetVelocity();
-				}
-			}
+			LeftRail = leftGrindRail->RailSpline;
+			LeftRailTargetDistance = leftTargetDistance;
+			INC_DWORD_STAT(STAT_SonicSplineEvaluations);
+			LeftRailTargetPoint = LeftRail->GetLocationAtDistanceAlongSpline(leftTargetDistance, ESplineCoordinateSpace::World);
+			LeftRailCollisionPoint = LeftRailTargetPoint;
 		}
 		else
 		{
@@ -473,6 +485,9 @@ void ASonicGameCharacter::RailBoost(FVector Direction)
 		if (Direction.Dot(GetActorForwardVector()) < 0.0f)
 		{
 			bBackwardsGrind = !bBackwardsGrind;
+			if (USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement()))
+				sonicMovement->SetBackwardsGrind(bBackwardsGrind);
+
 			SetVelocity(GetRailVelocityInDirection(newVelocity, bBackwardsGrind), true, true);
 		}
 		else
@@ -494,103 +509,106 @@ void ASonicGameCharacter::RailBoost(FVector Direction)
 
 void ASonicGameCharacter::GrindOnRail(float StartDistance, USplineComponent* Rail)
 {
-	if (Rail)
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicGrindOnRail);
+	SONIC_PERF_SCOPE(Grinding);
+
+	USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement());
+	if (!Rail || !sonicMovement)
+		return;
+
+	AGrindRail* grindRail = Cast<AGrindRail>(Rail->GetOwner());
+	if (!grindRail)
+		return;
+
+	// Jump on the rail, the movement component launches us off it on the next move
+	if (bGrindJump)
 	{
-		AGrindRail* grindRail = Cast<AGrindRail>(Rail->GetOwner());
-		// Check if we are on the rail
-		if (StartDistance <= Rail->GetSplineLength() && StartDistance > 0.0f)
-		{
-			// Jump on the rail
-			if (bGrindJump)
-			{
-				grindRail->RailJump();
+		sonicMovement->RequestRailJump();
 
-				FVector velocity = FVector(GetVelocity().X, GetVelocity().Y, 0.0f) * -1.0f;
-				FVector launchUp = Rail->GetUpVectorAtDistanceAlongSpline(StartDistance, ESplineCoordinateSpace::World) * RailJumpHeight;
-				FVector launchVelocity = FVector(velocity.X, velocity.Y, launchUp.Z);
-				LaunchCharacter(launchVelocity, true, true);
+		bIsGrinding = false;
+		return;
+	}
 
-				bIsGrinding = false;
-				GetCharacterMovement()->GravityScale = 1.0f;
-			}
-			// Move along the rail
-			else
-			{
-				// Calculate rail velocity
-				FVector railVelocity = Rail->GetTangentAtDistanceAlongSpline(StartDistance, ESplineCoordinateSpace::World).GetSafeNormal() * GetVelocity().Length();
-				FVector originalRailVelocity = railVelocity;
-				railVelocity = GetRailVelocityInDirection(railVelocity, bBackwardsGrind).GetClampedToSize(0.0f, MaxRailSpeed);
+	// Blueprints switch rails by setting CurrentRail and RailStartDistance, follow them onto the new rail
+	if (sonicMovement->GetGrindRail() != grindRail)
+	{
+		sonicMovement->StartGrinding(grindRail, StartDistance, bBackwardsGrind);
+	}
 
-				// Add friction based on angle of the rail
-				railVelocity += (GetActorForwardVector() * RailAccelerationMultiplier * GetWorld()->GetDeltaSeconds()) * GetActorRotation().Pitch;
-				if(railVelocity.Length() < 1.0f)
-					bBackwardsGrind = !bBackwardsGrind;
+	// The movement component does the actual moving in its grinding mode, it just needs the current tuning
+	sonicMovement->SetGrindingParams(GetRailParams());
 
+	if (sonicMovement->IsGrinding())
+	{
+		RailStartDistance = sonicMovement->GetRailDistance();
+		bBackwardsGrind = sonicMovement->IsBackwardsGrind();
+	}
+}
 
-				SetVelocity(railVelocity, true, true);
+SonicMovementSim::FRailParams ASonicGameCharacter::GetRailParams() const
+{
+	SonicMovementSim::FRailParams railParams;
+	railParams.MaxRailSpeed = MaxRailSpeed;
+	railParams.RailAccelerationMultiplier = RailAccelerationMultiplier;
+	railParams.RailOffset = RailOffset;
+	railParams.RailJumpHeight = RailJumpHeight;
+	return railParams;
+}
 
-				// Calculate player's location on the rail
-				FVector locationOnRail = Rail->GetLocationAtDistanceAlongSpline(StartDistance, ESplineCoordinateSpace::World) + (GetActorUpVector() * RailOffset);
-				
-				// Calculate player's rotation on the rail
-				FVector railUp = Rail->GetUpVectorAtDistanceAlongSpline(StartDistance, ESplineCoordinateSpace::World);
-				float railRoll = Rail->GetRollAtDistanceAlongSpline(StartDistance, ESplineCoordinateSpace::World);
-				FRotator rotationOnRail = UKismetMathLibrary::MakeRotFromXZ(UKismetMathLibrary::SelectVector(originalRailVelocity * -1.0f, originalRailVelocity, bBackwardsGrind), railUp);
-				rotationOnRail.Roll = railRoll;
+void ASonicGameCharacter::OnRailJump(AGrindRail* Rail)
+{
+	bIsGrinding = false;
 
-				SetActorLocationAndRotation(locationOnRail, rotationOnRail);
+	if (Rail)
+		Rail->RailJump();
+}
 
-				// Calculate delta to increment/decrement RailStartDistance by
-				float prevVelocityDelta = (float)(GetVelocity() * GetWorld()->GetDeltaSeconds()).Length();
-				float velocityDelta = (float)(railVelocity.Length() * GetWorld()->GetDeltaSeconds());
-				float railDelta = prevVelocityDelta + velocityDelta;
-				float zRange = UKismetMathLibrary::MapRangeClamped(GetActorForwardVector().Z, -1.0f, 1.0f, 1.15f, 0.55f);
+void ASonicGameCharacter::OnGrindRailEndReached(AGrindRail* Rail)
+{
+	// Exit the rail if we reach either end
+	bIsGrinding = false;
 
-				float forwardDelta = RailStartDistance + (railDelta * zRange);
-				float backwardsDelta = RailStartDistance - (railDelta * zRange);
+	if (!Rail)
+		return;
 
-				// Update RailStartDistance
-				RailStartDistance = UKismetMathLibrary::SelectFloat(backwardsDelta, forwardDelta, bBackwardsGrind);
-			}
-		}
-		else
-		{
-			// Circle back to beginning if rail is a closed loop
-			if (Rail->IsClosedLoop())
-			{
-				RailStartDistance = UKismetMathLibrary::SelectFloat(Rail->GetSplineLength(), 0.0f, bBackwardsGrind);
-			}
-			// Exit the rail if we reach either end
-			else
-			{
-				bIsGrinding = false;
-				GetCharacterMovement()->GravityScale = 1.0f;
-				grindRail->SetActorEnableCollision(false);
+	Rail->SetActorEnableCollision(false);
 
-				FVector launchVelocity = GetActorForwardVector() * GetVelocity().Length();
-				LaunchCharacter(launchVelocity, true, true);
+	FVector launchVelocity = GetActorForwardVector() * GetVelocity().Length();
+	LaunchCharacter(launchVelocity, true, true);
 
-				GetCharacterMovement()->SetMovementMode(MOVE_Walking);
-				Cast<USonicMovementComponent>(GetMovementComponent())->bIgnoreGrindingDecel = true;
+	GetCharacterMovement()->SetMovementMode(MOVE_Walking);
 
-				grindRail->ExitRail();
-			}
-		}
-	}
+	Rail->ExitRail();
 }
 
 float ASonicGameCharacter::GetClosestDistanceToLocation(USplineComponent* Spline, FVector Location, float ErrorTolerance)
 {
-	for (int i = 0; i < (int)Spline->GetSplineLength(); i++)
+	if (!Spline)
+		return -1.0f;
+
+	float distanceSq = 0.0f;
+	float distance = 0.0f;
+	float maxError = 0.0f;
+
+	AGrindRail* grindRail = Cast<AGrindRail>(Spline->GetOwner());
+	if (grindRail)
 	{
-		FVector splineLocation = Spline->GetLocationAtDistanceAlongSpline(i, ESplineCoordinateSpace::World);
-		float distance = FVector::Distance(splineLocation, Location);
-		
-		if(FMath::IsNearlyEqual(distance, 0.0f, ErrorTolerance))
-			return (float)i;
+		distance = grindRail->GetClosestDistanceToLocation(Location, &distanceSq);
+		maxError = grindRail->GetRailTable().GetMaxError();
+	}
+	else
+	{
+		INC_DWORD_STAT_BY(STAT_SonicSplineEvaluations, 3);
+		const float inputKey = Spline->FindInputKeyClosestToWorldLocation(Location);
+		distanceSq = FVector::DistSquared(Location, Spline->GetLocationAtSplineInputKey(inputKey, ESplineCoordinateSpace::World));
+		distance = Spline->GetDistanceAlongSplineAtSplineInputKey(inputKey);
 	}
 
-	return -1.0f;
+	// Location is too far from the rail, allowing for the error of the baked samples
+	if (distanceSq > FMath::Square(ErrorTolerance + maxError))
+		return -1.0f;
+
+	return distance;
 }
 
 void ASonicGameCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
@@ -619,10 +637,34 @@ void ASonicGameCharacter::Tick(float DeltaTime)
 	//UpdatePhysics(DeltaTime);
 	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, FString::Printf(TEXT("%f, %f, %f"), MoveInput.X, MoveInput.Y, MoveInput.Z));
 
+	// Set on every copy, the server and replays run homing attacks too
+	if (USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement()))
+	{
+		FSonicHomingParams homingParams;
+		homingParams.HomingSpeed = HomingSpeed;
+		homingParams.ReachDistance = MinHomingThreshold;
+		homingParams.ReboundSpeed = HomingUpForce;
+		homingParams.AirDashSpeed = HomingUpForce * 6.0f;
+		sonicMovement->SetHomingParams(homingParams);
+	}
+
 	DetectGrindRail();
 	DetectSideRail();
 }
 
+void ASonicGameCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if (USonicMovementComponent* sonicMovement = Cast<USonicMovementComponent>(GetCharacterMovement()))
+	{
+		sonicMovement->OnGrindRailEndReached.AddUObject(this, &ASonicGameCharacter::OnGrindRailEndReached);
+		sonicMovement->OnRailJump.AddUObject(this, &ASonicGameCharacter::OnRailJump);
+		sonicMovement->OnHomingStarted.AddUObject(this, &ASonicGameCharacter::OnHomingStarted);
+		sonicMovement->OnHomingFinished.AddUObject(this, &ASonicGameCharacter::OnHomingFinished);
+	}
+}
+
 void ASonicGameCharacter::TurnAtRate(float Rate)
 {
 	// calculate delta for this frame from the rate information
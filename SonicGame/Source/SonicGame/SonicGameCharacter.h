@@ -7,8 +7,13 @@
 #include "Components/SplineComponent.h"
 #include "Components/AudioComponent.h"
 #include "Particles/ParticleSystemComponent.h"
+#include "HomingTargetScoring.h"
+#include "SonicMovementReplication.h"
+#include "SonicMovementSim.h"
 #include "SonicGameCharacter.generated.h"
 
+class AGrindRail;
+
 UCLASS(config=Game)
 class ASonicGameCharacter : public ACharacter
 {
@@ -21,8 +26,16 @@ class ASonicGameCharacter : public ACharacter
 	/** Follow camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
+
+	/** Stands the capsule on the floor it is running on */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
+	class USurfaceAlignmentComponent* SurfaceAlignment;
+
+	/** Where on its rail the character is while grinding, sent to simulated proxies in place of the replicated movement. */
+	UPROPERTY(ReplicatedUsing = OnRep_RailMovement)
+	FSonicRepRailMovement RailMovement;
 public:
-	ASonicGameCharacter();
+	ASonicGameCharacter(const FObjectInitializer& ObjectInitializer);
 
 	void UpdatePhysics(float DeltaTime);
 
@@ -30,8 +43,6 @@ public:
 
 	void UpdateRotation(float DeltaTime);
 
-	void DoHomingAttack();
-
 	void AddVelocity(FVector Force);
 
 	void SetVelocity(FVector Velocity, bool bHorizontalOverride, bool bVerticalOverride, bool bUseAsMultiplier = false);
@@ -60,6 +71,36 @@ public:
 
 	void GrindOnRail(float StartDistance, USplineComponent* Rail);
 
+	/** Our rail tuning in the form the movement component takes it. */
+	SonicMovementSim::FRailParams GetRailParams() const;
+
+	/** Launches off the end of a rail, called by the movement component when grinding runs out of rail. */
+	void OnGrindRailEndReached(AGrindRail* Rail);
+
+	/** Called by the movement component when a requested rail jump has launched us off Rail. */
+	void OnRailJump(AGrindRail* Rail);
+
+	/** Called by the movement component when a requested homing attack or air dash starts. */
+	void OnHomingStarted(AActor* Target);
+
+	/** Called by the movement component when a homing attack ends, destroying the enemy it hit. */
+	void OnHomingFinished(AActor* Target, bool bReachedTarget);
+
+	/**
+	 * True if this copy of the character picks its own rails and homing targets: the owning client, or the server
+	 * or a standalone game for a character controlled there. Other copies follow what the movement component does.
+	 */
+	bool DrivesOwnMovement() const;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Swaps the replicated movement for RailMovement while grinding, see sonic.net.RailRelativeMovement. */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Rebuilds a simulated proxy's transform from the rail it is grinding on. */
+	UFUNCTION()
+	void OnRep_RailMovement();
+
 	float GetClosestDistanceToLocation(USplineComponent* Spline, FVector Location, float ErrorTolerance);
 
 	UFUNCTION(BlueprintImplementableEvent)
@@ -115,6 +156,18 @@ public:
 	UPROPERTY(Category = "Homing Attack", EditAnywhere, BlueprintReadWrite)
 	float MinHomingViewAngle = 95.0f;
 
+	/** How much being close counts when picking a homing target. */
+	UPROPERTY(Category = "Homing Attack", EditAnywhere, BlueprintReadWrite)
+	float HomingDistanceWeight = 1.0f;
+
+	/** How much being in front of Sonic counts when picking a homing target. */
+	UPROPERTY(Category = "Homing Attack", EditAnywhere, BlueprintReadWrite)
+	float HomingFacingWeight = 1.0f;
+
+	/** How much being in front of the camera counts when picking a homing target. */
+	UPROPERTY(Category = "Homing Attack", EditAnywhere, BlueprintReadWrite)
+	float HomingCameraWeight = 0.5f;
+
 	UPROPERTY(Category = "Homing Attack", EditAnywhere, BlueprintReadWrite)
 	bool bIsHoming = false;
 
@@ -131,6 +184,11 @@ public:
 
 	float HomingViewAngle;
 
+	/** Scratch space for scoring homing candidates, kept around to avoid reallocating every frame. */
+	FHomingCandidateBatch HomingCandidates;
+
+	TArray<AActor*> HomingCandidateActors;
+
 	//--- Rail Grinding --------------------------------------------------
 	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadWrite)
 	bool bIsGrinding;
@@ -162,6 +220,14 @@ public:
 	UPROPERTY(Category = "Rail Grinding", BlueprintReadWrite)
 	FVector RightRailTargetPoint;
 
+	/** Distance along LeftRail that a switch to the left lands on. */
+	UPROPERTY(Category = "Rail Grinding", BlueprintReadWrite)
+	float LeftRailTargetDistance;
+
+	/** Distance along RightRail that a switch to the right lands on. */
+	UPROPERTY(Category = "Rail Grinding", BlueprintReadWrite)
+	float RightRailTargetDistance;
+
 	UPROPERTY(Category = "Rail Grinding", EditAnywhere, BlueprintReadWrite)
 	float GrindLeanDirection;
 
@@ -216,10 +282,6 @@ public:
 
 	float LandingConversionFactor = 2.0f;
 
-	float GroundStickingFactor = 1.0f;
-
-	float GroundStickingDistance = 5.0f;
-
 	float SlopeSpeedLimit = 500.0f;
 
 	float SlopeRunAngleLimit = 0.5f;
@@ -252,6 +314,8 @@ protected:
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	virtual void Tick(float DeltaTime);
+
+	virtual void PostInitializeComponents() override;
 	// End of APawn interface
 
 public:
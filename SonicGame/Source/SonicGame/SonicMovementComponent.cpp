@@ -2,6 +2,11 @@
 
 
 #include "SonicMovementComponent.h"
+#include "SonicGame.h"
+#include "SonicPerfTracker.h"
+#include "SonicMovementSim.h"
+#include "GrindRail.h"
+#include "Enemy.h"
 
 #include "Kismet/KismetSystemLibrary.h"
 #include "Components/CapsuleComponent.h"
@@ -12,10 +17,48 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/PhysicsVolume.h"
 #include "GameFramework/GameNetworkManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Algo/BinarySearch.h"
+
+DECLARE_CYCLE_STAT(TEXT("Calc Velocity"), STAT_SonicCalcVelocity, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Grinding Step"), STAT_SonicStepGrinding, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Floor Probe"), STAT_SonicFloorProbe, STATGROUP_SonicGame);
+DECLARE_CYCLE_STAT(TEXT("Homing Step"), STAT_SonicStepHoming, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Movement Substeps"), STAT_SonicMovementSubsteps, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Substep Ceiling Hits"), STAT_SonicSubstepCeilingHits, STATGROUP_SonicGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Corrections"), STAT_SonicNetCorrections, STATGROUP_SonicGame);
+
+/** Furthest a client may start grinding from where the server has it, anything further is left for a correction. */
+static constexpr float MaxRemoteRailStartError = 250.0f;
+
+static FAutoConsoleCommandWithWorld CmdSonicNetCorrections(
+	TEXT("sonic.net.corrections"),
+	TEXT("Logs the server corrections each locally controlled character received in the last minute."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			const APlayerController* PlayerController = It->Get();
+			const ACharacter* Character = PlayerController && PlayerController->IsLocalController() ? Cast<ACharacter>(PlayerController->GetPawn()) : nullptr;
+			if (const USonicMovementComponent* SonicMovement = Character ? Cast<USonicMovementComponent>(Character->GetCharacterMovement()) : nullptr)
+			{
+				UE_LOG(LogSonicGame, Display, TEXT("%s: %d corrections in the last minute, %d in total"),
+					*Character->GetName(), SonicMovement->GetCorrectionsPerMinute(), SonicMovement->GetTotalCorrections());
+			}
+		}
+	}));
 
 USonicMovementComponent::USonicMovementComponent()
 {
-	SetWalkableFloorAngle(360.0f);
+	SetNetworkMoveDataContainer(SonicNetworkMoveDataContainer);
+	SetMoveResponseDataContainer(SonicMoveResponseDataContainer);
 }
 
 FVector USonicMovementComponent::GetComponentAxisZ() const
@@ -28,8 +71,27 @@ FVector USonicMovementComponent::GetComponentAxisZ() const
 		FMath::Square(ComponentRotation.W) - QuatVector.SizeSquared()) + QuatVector * (ComponentRotation.Z * 2.0f);
 }
 
+void USonicMovementComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	// Clamped to 90 degrees, which makes walls walkable
+	if (bUseSonicGroundMovement)
+	{
+		SetWalkableFloorAngle(360.0f);
+	}
+}
+
 void USonicMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
 {
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicCalcVelocity);
+
+	if (!bUseSonicGroundMovement)
+	{
+		Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+		return;
+	}
+
 	// Do not update velocity when using root motion or when SimulatedProxy - SimulatedProxy are repped their Velocity
 	if (!HasValidData() || HasAnimRootMotion() || DeltaTime < MIN_TICK_TIME || (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy))
 	{
@@ -71,65 +133,68 @@ void USonicMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool
 	// Use max of requested speed and max speed if we modified the speed in ApplyRequestedMove above.
 	MaxSpeed = FMath::Max3(RequestedSpeed, MaxSpeed * AnalogInputModifier, GetMinAnalogSpeed());
 
-	// Apply braking or deceleration
-	const bool bZeroAcceleration = Acceleration.IsZero();
-	const bool bVelocityOverMax = false;
+	// Braking, friction and acceleration are done by the world-free simulation code
+	SonicMovementSim::FVelocityParams Params;
+	Params.DeltaTime = DeltaTime;
+	Params.Friction = Friction;
+	Params.BrakingFriction = BrakingFriction;
+	Params.BrakingFrictionFactor = BrakingFrictionFactor;
+	Params.BrakingDeceleration = BrakingDeceleration;
+	Params.BrakingSubStepTime = BrakingSubStepTime;
+	Params.MaxSpeed = MaxSpeed;
+	Params.bUseSeparateBrakingFriction = bUseSeparateBrakingFriction;
+	Params.bFluid = bFluid;
+	Params.Acceleration = Acceleration;
+	Params.RequestedAcceleration = RequestedAcceleration;
+	Params.bZeroRequestedAcceleration = bZeroRequestedAcceleration;
+
+	SonicMovementSim::CalcVelocity(Params, Velocity);
 
-	if (bIgnoreGrindingDecel)
+	if (bUseRVOAvoidance)
 	{
-		// Only apply braking if there is no acceleration, or we are over our max speed and need to slow down to it.
-		if ((bZeroAcceleration && bZeroRequestedAcceleration) || bVelocityOverMax)
-		{
-			const FVector OldVelocity = Velocity;
+		CalcAvoidanceVelocity(DeltaTime);
+	}
+}
 
-			const float ActualBrakingFriction = (bUseSeparateBrakingFriction ? BrakingFriction : Friction);
-			ApplyVelocityBraking(DeltaTime, ActualBrakingFriction, BrakingDeceleration);
 
-			// Don't allow braking to lower us below max speed if we started above it.
-			if (bVelocityOverMax && Velocity.SizeSquared() < FMath::Square(MaxSpeed) && FVector::DotProduct(Acceleration, OldVelocity) > 0.0f)
-			{
-				Velocity = OldVelocity.GetSafeNormal() * MaxSpeed;
-			}
-		}
-		else if (!bZeroAcceleration)
-		{
-			// Friction affects our ability to change direction. This is only done for input acceleration, not path following.
-			const FVector AccelDir = Acceleration.GetSafeNormal();
-			const float VelSize = Velocity.Size();
-			Velocity = Velocity - (Velocity - AccelDir * VelSize) * FMath::Min(DeltaTime * Friction, 1.f);
-		}
+FVector USonicMovementComponent::MoveTowards(FVector current, FVector target, float maxDistanceDelta)
+{
+	return SonicMovementSim::MoveTowards(current, target, maxDistanceDelta);
+}
 
-		// Apply fluid friction
-		if (bFluid)
-		{
-			Velocity = Velocity * (1.f - FMath::Min(Friction * DeltaTime, 1.f));
-		}
+float USonicMovementComponent::GetSimulationTimeStep(float RemainingTime, int32 Iterations) const
+{
+	INC_DWORD_STAT(STAT_SonicMovementSubsteps);
 
-		// Apply acceleration
-		const float NewMaxSpeed = (IsExceedingMaxSpeed(MaxSpeed)) ? Velocity.Size() : MaxSpeed;
-		Velocity += Acceleration * DeltaTime;
-		Velocity += RequestedAcceleration * DeltaTime;
-		Velocity = Velocity.GetClampedToMaxSize(NewMaxSpeed);
+	const float TimeStep = Super::GetSimulationTimeStep(RemainingTime, Iterations);
+	const float Speed = Velocity.Size();
+	if (MaxSubstepDistance <= 0.0f || Speed * TimeStep <= MaxSubstepDistance)
+	{
+		return TimeStep;
+	}
 
-		if (bUseRVOAvoidance)
-		{
-			CalcAvoidanceVelocity(DeltaTime);
-		}
+	// Iterations counts from 1, and the move must be finished by the last substep we allow
+	const int32 MaxSubsteps = FMath::Min(MaxSpeedSubsteps, MaxSimulationIterations);
+	const int32 SubstepsLeft = MaxSubsteps - Iterations + 1;
+	if (SubstepsLeft <= 1)
+	{
+		INC_DWORD_STAT(STAT_SonicSubstepCeilingHits);
+		return TimeStep;
 	}
-}
 
+	// Spread what's left evenly over the remaining substeps when they can't all stay under MaxSubstepDistance
+	const float SpeedTimeStep = FMath::Max(MaxSubstepDistance / Speed, RemainingTime / SubstepsLeft);
 
-FVector USonicMovementComponent::MoveTowards(FVector current, FVector target, float maxDistanceDelta)
-{
-	FVector v = target - current;
-	float magnitude = v.Length();
-	if(magnitude <= maxDistanceDelta || magnitude == 0.0f)
-		return target;
-	return current + v / magnitude * maxDistanceDelta;
+	return FMath::Max(FMath::Min(TimeStep, SpeedTimeStep), MIN_TICK_TIME);
 }
 
 bool USonicMovementComponent::DoJump(bool bReplayingMoves)
 {
+	if (!bUseSonicGroundMovement)
+	{
+		return Super::DoJump(bReplayingMoves);
+	}
+
 	const FVector JumpDir = GetComponentAxisZ();
 
 	if (CharacterOwner && CharacterOwner->CanJump())
@@ -146,3 +211,547 @@ bool USonicMovementComponent::DoJump(bool bReplayingMoves)
 
 	return false;
 }
+
+void USonicMovementComponent::StartGrinding(AGrindRail* Rail, float Distance, bool bBackwards)
+{
+	if (!Rail)
+	{
+		return;
+	}
+
+	GrindRail = Rail;
+	RailDistance = Distance;
+	bBackwardsGrind = bBackwards;
+
+	// Slower than the rail allows, pushed up to its minimum speed along the direction of travel
+	if (Velocity.Size() < Rail->MinRailSpeed)
+	{
+		const FVector Tangent = Rail->GetRailFrameAtDistance(Distance).Tangent.GetSafeNormal();
+		Velocity = Tangent * (bBackwards ? -Rail->MinRailSpeed : Rail->MinRailSpeed);
+	}
+
+	SetMovementMode(MOVE_Custom, CMOVE_Grinding);
+}
+
+void USonicMovementComponent::StopGrinding()
+{
+	if (IsGrinding())
+	{
+		SetMovementMode(MOVE_Falling);
+	}
+}
+
+void USonicMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == CMOVE_Grinding)
+	{
+		StepGrinding(deltaTime);
+		return;
+	}
+
+	if (CustomMovementMode == CMOVE_Homing)
+	{
+		PhysHoming(deltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void USonicMovementComponent::StepGrinding(float DeltaTime)
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicStepGrinding);
+	SONIC_PERF_SCOPE(Grinding);
+
+	USplineComponent* Rail = GrindRail ? GrindRail->RailSpline : nullptr;
+	if (!Rail || DeltaTime < MIN_TICK_TIME)
+	{
+		if (!Rail)
+		{
+			StopGrinding();
+		}
+		return;
+	}
+
+	SonicMovementSim::FRailState RailState;
+	RailState.Distance = RailDistance;
+	RailState.bBackwards = bBackwardsGrind;
+	RailState.Velocity = Velocity;
+	RailState.Rotation = UpdatedComponent->GetComponentRotation();
+
+	const SonicMovementSim::ERailEndResult RailEnd = SonicMovementSim::ResolveRailEnd(Rail->GetSplineLength(), Rail->IsClosedLoop(), RailState);
+	if (RailEnd == SonicMovementSim::ERailEndResult::Exited)
+	{
+		// The owner decides how to leave the rail, usually by launching off it
+		AGrindRail* EndedRail = GrindRail;
+		StopGrinding();
+		OnGrindRailEndReached.Broadcast(EndedRail);
+		return;
+	}
+
+	if (RailEnd == SonicMovementSim::ERailEndResult::Wrapped)
+	{
+		// Closed loops carry on from the other end next step, like before
+		RailDistance = RailState.Distance;
+		return;
+	}
+
+	const FRailFrame RailFrame = GrindRail->GetRailFrameAtDistance(RailDistance);
+
+	SonicMovementSim::FRailSample RailSample;
+	RailSample.Location = RailFrame.Location;
+	RailSample.Tangent = RailFrame.Tangent;
+	RailSample.Up = RailFrame.Up;
+	RailSample.Roll = RailFrame.Roll;
+
+	SonicMovementSim::FRailParams Params = GrindingParams;
+	Params.DeltaTime = DeltaTime;
+
+	SonicMovementSim::StepRail(RailSample, Params, RailState);
+
+	Velocity = RailState.Velocity;
+	RailDistance = RailState.Distance;
+	bBackwardsGrind = RailState.bBackwards;
+
+	// The rail is the only thing moving us, so snap onto it without sweeping
+	const FVector Delta = RailState.Location - UpdatedComponent->GetComponentLocation();
+	MoveUpdatedComponent(Delta, RailState.Rotation.Quaternion(), false, nullptr, ETeleportType::None);
+}
+
+void USonicMovementComponent::PhysWalking(float deltaTime, int32 Iterations)
+{
+	UpdateFloorProbe(deltaTime);
+
+	Super::PhysWalking(deltaTime, Iterations);
+
+	// Ran off the ground during the step
+	if (IsFalling())
+	{
+		StickToPredictedFloor(deltaTime);
+	}
+}
+
+bool USonicMovementComponent::GetPredictedFloor(float LeadDistance, FSonicFloorSample& OutSample) const
+{
+	return IsMovingOnGround() && FloorProbe.GetFloorAhead(LeadDistance, OutSample);
+}
+
+void USonicMovementComponent::UpdateFloorProbe(float DeltaTime)
+{
+	const float Speed = Velocity.Size();
+	if (!CurrentFloor.IsWalkableFloor() || Speed < FloorProbeMinSpeed)
+	{
+		FloorProbe.Invalidate();
+		return;
+	}
+
+	const float StepDistance = Speed * DeltaTime;
+	FloorProbe.Advance(StepDistance);
+	TimeSinceFloorProbe += DeltaTime;
+
+	// Steering off the probed path makes the rest of it useless
+	FSonicFloorSample Here;
+	const bool bOnPath = FloorProbe.GetFloorAhead(0.0f, Here) && (FVector::VectorPlaneProject(Velocity, Here.Normal).GetSafeNormal() | Here.Forward) >= 0.9f;
+
+	if (bOnPath && TimeSinceFloorProbe < FloorProbeInterval && FloorProbe.GetRemainingDistance() > StepDistance)
+	{
+		return;
+	}
+
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicFloorProbe);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SonicFloorProbe), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	InitCollisionParams(QueryParams, ResponseParams);
+
+	const int32 NumSamples = FMath::Max(FloorProbeSamples, 1);
+	const float SampleSpacing = FMath::Max(Speed * FloorProbeLookAheadTime / NumSamples, 10.0f);
+
+	FloorProbe.Probe(GetWorld(), CurrentFloor.HitResult.ImpactPoint, CurrentFloor.HitResult.ImpactNormal, Velocity, SampleSpacing, NumSamples,
+		UpdatedComponent->GetCollisionObjectType(), QueryParams, ResponseParams);
+	TimeSinceFloorProbe = 0.0f;
+}
+
+bool USonicMovementComponent::StickToPredictedFloor(float DeltaTime)
+{
+	FSonicFloorSample Floor;
+	const bool bHasFloor = FloorProbe.GetFloorAhead(0.0f, Floor);
+	FloorProbe.Invalidate();
+
+	// Launched upwards rather than running off
+	if (!bHasFloor || !CharacterOwner || Velocity.Z > 0.0f)
+	{
+		return false;
+	}
+
+	const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FVector CapsuleBottom = UpdatedComponent->GetComponentLocation() - Floor.Normal * HalfHeight;
+	const float Gap = (CapsuleBottom - Floor.Location) | Floor.Normal;
+	const float MaxGap = GroundStickingDistance + GroundStickingFactor * Velocity.Size() * DeltaTime;
+	if (Gap <= 0.0f || Gap > MaxGap)
+	{
+		return false;
+	}
+
+	FHitResult Hit;
+	SafeMoveUpdatedComponent(-Floor.Normal * Gap, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false);
+	if (!CurrentFloor.IsWalkableFloor())
+	{
+		return false;
+	}
+
+	SetMovementMode(MOVE_Walking);
+	return true;
+}
+
+void USonicMovementComponent::PhysicsRotation(float DeltaTime)
+{
+	// Grinding sets the rotation from the rail, homing faces the target from the start
+	if (IsGrinding() || IsHoming())
+	{
+		return;
+	}
+
+	Super::PhysicsRotation(DeltaTime);
+}
+
+void USonicMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	if (PreviousMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Grinding && !IsGrinding())
+	{
+		GrindRail = nullptr;
+	}
+
+	// Taken out of a homing attack by something other than FinishHoming, or landed after one
+	const bool bLeftHoming = PreviousMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Homing && !IsHoming();
+	if ((bLeftHoming && HomingPhase == ESonicHomingPhase::Seeking) || IsMovingOnGround() || IsGrinding())
+	{
+		HomingTarget = nullptr;
+		HomingPhase = ESonicHomingPhase::None;
+	}
+}
+
+void USonicMovementComponent::RequestHomingAttack(AActor* Target)
+{
+	bWantsHoming = true;
+	RequestedHomingTarget = Target;
+}
+
+void USonicMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// Saved moves have copied the requests by now, they only apply to this move
+	if (bWantsRailJump)
+	{
+		bWantsRailJump = false;
+
+		if (IsGrinding())
+		{
+			DoRailJump();
+		}
+	}
+
+	if (bWantsHoming)
+	{
+		AActor* Target = RequestedHomingTarget.Get();
+		bWantsHoming = false;
+		RequestedHomingTarget = nullptr;
+
+		if (IsFalling())
+		{
+			StartHoming(Target);
+		}
+		else
+		{
+			// Landed or started grinding since the request, it never gets going
+			if (!IsReplayingMoves())
+			{
+				OnHomingFinished.Broadcast(Target, false);
+			}
+		}
+	}
+}
+
+void USonicMovementComponent::DoRailJump()
+{
+	AGrindRail* Rail = GrindRail;
+	const FRailFrame RailFrame = Rail->GetRailFrameAtDistance(RailDistance);
+	const FVector LaunchVelocity = SonicMovementSim::GetRailJumpVelocity(Velocity, RailFrame.Up, GrindingParams);
+
+	StopGrinding();
+	Velocity = LaunchVelocity;
+
+	if (!IsReplayingMoves())
+	{
+		OnRailJump.Broadcast(Rail);
+	}
+}
+
+void USonicMovementComponent::StartHoming(AActor* Target)
+{
+	if (Target && !Target->IsActorBeingDestroyed())
+	{
+		HomingTarget = Target;
+		HomingPhase = ESonicHomingPhase::Seeking;
+		Velocity = FVector::ZeroVector;
+
+		const FVector ToTarget = Target->GetActorLocation() - UpdatedComponent->GetComponentLocation();
+		MoveUpdatedComponent(FVector::ZeroVector, ToTarget.Rotation().Quaternion(), false);
+
+		SetMovementMode(MOVE_Custom, CMOVE_Homing);
+	}
+	else
+	{
+		HomingTarget = nullptr;
+		HomingPhase = ESonicHomingPhase::AirDash;
+		Velocity = UpdatedComponent->GetForwardVector() * HomingParams.AirDashSpeed;
+	}
+
+	if (!IsReplayingMoves())
+	{
+		OnHomingStarted.Broadcast(HomingTarget.Get());
+	}
+}
+
+void USonicMovementComponent::PhysHoming(float DeltaTime, int32 Iterations)
+{
+	SONIC_SCOPE_CYCLE_COUNTER(STAT_SonicStepHoming);
+	SONIC_PERF_SCOPE(Homing);
+
+	// The target may have been destroyed by something else since we locked on
+	const AActor* Target = HomingTarget.Get();
+	if (!Target || Target->IsActorBeingDestroyed())
+	{
+		FinishHoming(false);
+		return;
+	}
+
+	if (DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector TargetLocation = Target->GetActorLocation();
+	if (FVector::DistSquared(Location, TargetLocation) <= FMath::Square(HomingParams.ReachDistance))
+	{
+		FinishHoming(true);
+		return;
+	}
+
+	const FVector Delta = FMath::VInterpTo(Location, TargetLocation, DeltaTime, HomingParams.HomingSpeed) - Location;
+	Velocity = Delta / DeltaTime;
+
+	FHitResult Hit;
+	SafeMoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	// Hit something before making it to the target
+	if (Hit.bBlockingHit)
+	{
+		FinishHoming(false);
+	}
+}
+
+void USonicMovementComponent::FinishHoming(bool bReachedTarget)
+{
+	AActor* Target = HomingTarget.Get();
+	HomingTarget = nullptr;
+
+	// Only enemies are bounced off, anything else just stops the attack
+	if (bReachedTarget && Cast<AEnemy>(Target))
+	{
+		HomingPhase = ESonicHomingPhase::Rebound;
+		Velocity = FVector(0.0f, 0.0f, HomingParams.ReboundSpeed);
+	}
+	else
+	{
+		HomingPhase = ESonicHomingPhase::None;
+		Velocity = FVector::ZeroVector;
+	}
+
+	SetMovementMode(MOVE_Falling);
+
+	if (!IsReplayingMoves())
+	{
+		OnHomingFinished.Broadcast(Target, bReachedTarget);
+	}
+}
+
+bool USonicMovementComponent::IsReplayingMoves() const
+{
+	return CharacterOwner && CharacterOwner->bClientUpdating;
+}
+
+void USonicMovementComponent::FollowMoveGrindState(AGrindRail* Rail, float Distance, bool bBackwards)
+{
+	if (!Rail)
+	{
+		if (IsGrinding())
+		{
+			StopGrinding();
+		}
+		return;
+	}
+
+	if (IsGrinding() && GrindRail == Rail)
+	{
+		return;
+	}
+
+	// Don't let a client start grinding somewhere it can't have reached
+	const FVector RailLocation = Rail->GetRailFrameAtDistance(Distance).Location;
+	if (FVector::DistSquared(RailLocation, UpdatedComponent->GetComponentLocation()) > FMath::Square(GrindingParams.RailOffset + MaxRemoteRailStartError))
+	{
+		return;
+	}
+
+	StartGrinding(Rail, Distance, bBackwards);
+}
+
+void USonicMovementComponent::GetGrindTransform(FVector& OutLocation, FQuat& OutRotation) const
+{
+	const FRailFrame RailFrame = GrindRail->GetRailFrameAtDistance(RailDistance);
+
+	FRotator Rotation = FRotationMatrix::MakeFromXZ(bBackwardsGrind ? -RailFrame.Tangent : RailFrame.Tangent, RailFrame.Up).Rotator();
+	Rotation.Roll = RailFrame.Roll;
+
+	OutRotation = Rotation.Quaternion();
+	OutLocation = RailFrame.Location + OutRotation.GetUpVector() * GrindingParams.RailOffset;
+}
+
+void USonicMovementComponent::ApplyReplicatedRailMovement(AGrindRail* Rail, float Distance, float Speed, bool bBackwards)
+{
+	if (!Rail)
+	{
+		GrindRail = nullptr;
+		SimulatedRailSpeed = 0.0f;
+		return;
+	}
+
+	if (!CharacterOwner || !UpdatedComponent)
+	{
+		return;
+	}
+
+	GrindRail = Rail;
+	RailDistance = Distance;
+	bBackwardsGrind = bBackwards;
+	SimulatedRailSpeed = Speed;
+
+	FVector NewLocation;
+	FQuat NewRotation;
+	GetGrindTransform(NewLocation, NewRotation);
+
+	// Same as ACharacter::PostNetReceiveLocationAndRotation does with a replicated location
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FQuat OldRotation = UpdatedComponent->GetComponentQuat();
+
+	bNetworkSmoothingComplete = false;
+	bJustTeleported |= OldLocation != NewLocation;
+	SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
+
+	Velocity = NewRotation.GetForwardVector() * Speed;
+	CharacterOwner->OnUpdateSimulatedPosition(OldLocation, OldRotation);
+}
+
+void USonicMovementComponent::SimulateMovement(float DeltaTime)
+{
+	// Between rail updates simulated proxies carry on along the rail instead of in a straight line
+	USplineComponent* Rail = GrindRail ? GrindRail->RailSpline : nullptr;
+	if (!Rail || !IsGrinding() || !CharacterOwner || CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		Super::SimulateMovement(DeltaTime);
+		return;
+	}
+
+	const float RailDelta = SonicMovementSim::GetRailDistanceRate(SimulatedRailSpeed, UpdatedComponent->GetForwardVector()) * DeltaTime;
+	const float RailLength = Rail->GetSplineLength();
+	RailDistance += bBackwardsGrind ? -RailDelta : RailDelta;
+
+	// Stop at the ends and wait for the server to say where we went
+	RailDistance = Rail->IsClosedLoop() && RailLength > 0.0f ? FMath::Fmod(FMath::Fmod(RailDistance, RailLength) + RailLength, RailLength) : FMath::Clamp(RailDistance, 0.0f, RailLength);
+
+	FVector NewLocation;
+	FQuat NewRotation;
+	GetGrindTransform(NewLocation, NewRotation);
+
+	UpdatedComponent->SetWorldLocationAndRotation(NewLocation, NewRotation, false, nullptr, ETeleportType::None);
+
+	Velocity = NewRotation.GetForwardVector() * SimulatedRailSpeed;
+
+	LastUpdateLocation = NewLocation;
+	LastUpdateRotation = NewRotation;
+	LastUpdateVelocity = Velocity;
+}
+
+FNetworkPredictionData_Client* USonicMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		USonicMovementComponent* MutableThis = const_cast<USonicMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Sonic(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void USonicMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsRailJump = (Flags & FSavedMove_Sonic::FLAG_RailJump) != 0;
+	bWantsHoming = (Flags & FSavedMove_Sonic::FLAG_Homing) != 0;
+}
+
+void USonicMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
+{
+	// Only set while the server runs a client's move, replays get the same from FSavedMove_Sonic::PrepMoveFor
+	if (const FSonicNetworkMoveData* MoveData = static_cast<const FSonicNetworkMoveData*>(GetCurrentNetworkMoveData()))
+	{
+		RequestedHomingTarget = MoveData->RequestedHomingTarget;
+		FollowMoveGrindState(MoveData->GrindRail, MoveData->RailDistance, MoveData->bBackwardsGrind);
+	}
+
+	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+}
+
+void USonicMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	// In place before Super applies the server's movement mode, so the replay starts grinding or homing where the server was
+	if (MoveResponse.IsCorrection())
+	{
+		const FSonicMoveResponseDataContainer& SonicResponse = static_cast<const FSonicMoveResponseDataContainer&>(MoveResponse);
+		GrindRail = SonicResponse.GrindRail;
+		RailDistance = SonicResponse.RailDistance;
+		bBackwardsGrind = SonicResponse.bBackwardsGrind;
+		HomingTarget = SonicResponse.HomingTarget;
+		HomingPhase = SonicResponse.HomingPhase;
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+void USonicMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase,
+	FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+
+	INC_DWORD_STAT(STAT_SonicNetCorrections);
+	TotalCorrections++;
+
+	const double Now = FPlatformTime::Seconds();
+	CorrectionTimes.Add(Now);
+
+	const int32 NumExpired = Algo::LowerBound(CorrectionTimes, Now - 60.0);
+	CorrectionTimes.RemoveAt(0, NumExpired, false);
+}
+
+int32 USonicMovementComponent::GetCorrectionsPerMinute() const
+{
+	return CorrectionTimes.Num() - Algo::LowerBound(CorrectionTimes, FPlatformTime::Seconds() - 60.0);
+}
@@ -4,8 +4,48 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "SonicMovementSim.h"
+#include "SonicFloorProbe.h"
+#include "SonicMovementReplication.h"
 #include "SonicMovementComponent.generated.h"
 
+class AGrindRail;
+
+UENUM(BlueprintType)
+enum ESonicCustomMovementMode
+{
+	CMOVE_None		UMETA(Hidden),
+
+	/** Moving along a grind rail by arc length. */
+	CMOVE_Grinding	UMETA(DisplayName = "Grinding"),
+
+	/** Flying at a homing attack target. */
+	CMOVE_Homing	UMETA(DisplayName = "Homing"),
+
+	CMOVE_MAX		UMETA(Hidden)
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGrindRailEndReached, AGrindRail* /*Rail*/);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnRailJump, AGrindRail* /*Rail*/);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnHomingStarted, AActor* /*Target*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnHomingFinished, AActor* /*Target*/, bool /*bReachedTarget*/);
+
+/** Homing attack tuning, set by the owner every frame like the grinding params. */
+struct FSonicHomingParams
+{
+	/** Interpolation speed towards the target, as in FMath::VInterpTo. */
+	float HomingSpeed = 10.0f;
+
+	/** Distance to the target that counts as hitting it. */
+	float ReachDistance = 100.0f;
+
+	/** Upwards speed after hitting an enemy. */
+	float ReboundSpeed = 700.0f;
+
+	/** Speed of the dash done without a target. */
+	float AirDashSpeed = 4200.0f;
+};
+
 /**
  * 
  */
@@ -23,10 +63,67 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float TangentialDrag;
 
+	/**
+	 * Walk up walls, jump along the capsule's up axis and keep momentum above max speed instead of braking down to it.
+	 * Off by default, leaving everything but grinding and homing to the stock character movement.
+	 */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite)
+	bool bUseSonicGroundMovement = false;
+
+	/** No longer read. Grinding runs in its own movement mode and never goes through CalcVelocity. Kept for Blueprints that still set it. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	bool bIgnoreGrindingDecel = true;
 
+	/**
+	 * Furthest the character may move in one simulation substep. Faster movement is split into more substeps
+	 * so boosting doesn't tunnel through thin geometry. 0 leaves substepping to the engine settings.
+	 */
+	UPROPERTY(Category = "Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm"))
+	float MaxSubstepDistance = 20.0f;
+
+	/** Most substeps speed may split a move into, capping the cost of a frame. Also limited by MaxSimulationIterations. */
+	UPROPERTY(Category = "Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", ClampMax = "25", UIMin = "1", UIMax = "25"))
+	int32 MaxSpeedSubsteps = 6;
+
+	/** Seconds between probes of the ground ahead while running. The floor in between is read from the last probe. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "s"))
+	float FloorProbeInterval = 0.05f;
+
+	/** How far ahead the ground is probed, in seconds of travel at the current speed. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "s"))
+	float FloorProbeLookAheadTime = 0.25f;
+
+	/** Line traces per probe of the ground ahead. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1", UIMax = "8"))
+	int32 FloorProbeSamples = 4;
+
+	/** Slowest ground speed the ground ahead is probed at. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float FloorProbeMinSpeed = 600.0f;
+
+	/** Gap to the predicted floor the character is pulled back down over after running off a crest, instead of leaving the ground. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm"))
+	float GroundStickingDistance = 5.0f;
+
+	/** Extra gap allowed per unit moved in the step, so faster running sticks over sharper crests. */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+	float GroundStickingFactor = 1.0f;
+
+	/** Broadcast when grinding runs off the end of a rail that isn't a closed loop. */
+	FOnGrindRailEndReached OnGrindRailEndReached;
+
+	/** Broadcast when a requested rail jump launches the character off its rail. */
+	FOnRailJump OnRailJump;
+
+	/** Broadcast when a requested homing attack starts, with a null target for an air dash. */
+	FOnHomingStarted OnHomingStarted;
+
+	/** Broadcast when a homing attack reaches its target, hits something else or loses its target. */
+	FOnHomingFinished OnHomingFinished;
+
 public:
+	virtual void InitializeComponent() override;
+
 	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
 
 	/**
@@ -37,8 +134,165 @@ public:
 	 */
 	virtual bool DoJump(bool bReplayingMoves) override;
 
+	/** Shortens the step when the character would otherwise move more than MaxSubstepDistance in it. */
+	virtual float GetSimulationTimeStep(float RemainingTime, int32 Iterations) const override;
+
+	/** Switches to the grinding movement mode on Rail, Distance along it. */
+	void StartGrinding(AGrindRail* Rail, float Distance, bool bBackwards);
+
+	/** Leaves the grinding movement mode, falling off the rail. */
+	void StopGrinding();
+
+	bool IsGrinding() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Grinding; }
+
+	AGrindRail* GetGrindRail() const { return GrindRail; }
+
+	float GetRailDistance() const { return RailDistance; }
+
+	bool IsBackwardsGrind() const { return bBackwardsGrind; }
+
+	void SetBackwardsGrind(bool bBackwards) { bBackwardsGrind = bBackwards; }
+
+	/** Speed limit, slope acceleration and rail offset used while grinding. DeltaTime is ignored. */
+	void SetGrindingParams(const SonicMovementSim::FRailParams& Params) { GrindingParams = Params; }
+
+	/**
+	 * Puts a simulated proxy Distance along Rail from replicated rail movement, smoothing the mesh over the jump.
+	 * SimulateMovement carries it on along the rail at Speed until the next update. A null Rail takes it off the rail.
+	 */
+	void ApplyReplicatedRailMovement(AGrindRail* Rail, float Distance, float Speed, bool bBackwards);
+
+	/** Jumps off the rail at the start of the next move. Predicted, the request reaches the server with that move. */
+	void RequestRailJump() { bWantsRailJump = true; }
+
+	/**
+	 * Starts a homing attack on Target at the start of the next move, or an air dash if Target is null.
+	 * Only done while falling. Predicted, the request and its target reach the server with that move.
+	 */
+	void RequestHomingAttack(AActor* Target);
+
+	void SetHomingParams(const FSonicHomingParams& Params) { HomingParams = Params; }
+
+	bool IsHoming() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Homing; }
+
+	AActor* GetHomingTarget() const { return HomingTarget.Get(); }
+
+	ESonicHomingPhase GetHomingPhase() const { return HomingPhase; }
+
+	/** Server corrections this client received in the last minute. */
+	int32 GetCorrectionsPerMinute() const;
+
+	/** Server corrections this client received since it started. */
+	int32 GetTotalCorrections() const { return TotalCorrections; }
+
+	/**
+	 * Moves one step along the rail: one velocity integration and one transform update.
+	 * Called from PhysCustom, public so the step can be benchmarked on its own.
+	 */
+	void StepGrinding(float DeltaTime);
+
+	/**
+	 * Floor LeadDistance ahead of the character along its path, from the last probe of the ground ahead.
+	 * @return False unless running on the ground faster than FloorProbeMinSpeed, or if LeadDistance is past the probed path
+	 */
+	bool GetPredictedFloor(float LeadDistance, FSonicFloorSample& OutSample) const;
+
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+
+protected:
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+
+	virtual void PhysWalking(float deltaTime, int32 Iterations) override;
+
+	virtual void PhysicsRotation(float DeltaTime) override;
+
+	virtual void SimulateMovement(float DeltaTime) override;
+
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+	virtual void OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase,
+		FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+
 	//virtual bool IsWalkable(const FHitResult& Hit) const override;
 
 private:
 	FVector MoveTowards(FVector current, FVector target, float maxDistanceDelta);
+
+	/** Moves along the probed ground, probing again when the probe is old, used up or no longer where the character is heading. */
+	void UpdateFloorProbe(float DeltaTime);
+
+	/** Pulls the character back onto the predicted floor after it walked off a crest. True if it is walking again. */
+	bool StickToPredictedFloor(float DeltaTime);
+
+	void DoRailJump();
+
+	/** Flies at the target, or dashes forward if there is none. */
+	void StartHoming(AActor* Target);
+
+	void PhysHoming(float DeltaTime, int32 Iterations);
+
+	void FinishHoming(bool bReachedTarget);
+
+	/**
+	 * True while a client replays its saved moves after a correction. The rail jump and homing events were already
+	 * broadcast when the moves were first made, so they aren't broadcast again.
+	 */
+	bool IsReplayingMoves() const;
+
+	/**
+	 * Gets on or off a rail to match the state a client move started with. Clients get on and off rails between moves,
+	 * so the server and replays of saved moves follow them here.
+	 */
+	void FollowMoveGrindState(AGrindRail* Rail, float Distance, bool bBackwards);
+
+	/** Where grinding puts the character at RailDistance, the way StepGrinding places it. */
+	void GetGrindTransform(FVector& OutLocation, FQuat& OutRotation) const;
+
+	friend class FSavedMove_Sonic;
+
+	UPROPERTY(Transient)
+	TObjectPtr<AGrindRail> GrindRail;
+
+	float RailDistance = 0.0f;
+
+	bool bBackwardsGrind = false;
+
+	SonicMovementSim::FRailParams GrindingParams;
+
+	/** Rail speed of a simulated proxy, from the last replicated rail movement. */
+	float SimulatedRailSpeed = 0.0f;
+
+	FSonicHomingParams HomingParams;
+
+	TWeakObjectPtr<AActor> HomingTarget;
+
+	ESonicHomingPhase HomingPhase = ESonicHomingPhase::None;
+
+	/** Requests for the next move, sent to the server as compressed flags. */
+	bool bWantsRailJump = false;
+
+	bool bWantsHoming = false;
+
+	TWeakObjectPtr<AActor> RequestedHomingTarget;
+
+	FSonicNetworkMoveDataContainer SonicNetworkMoveDataContainer;
+
+	FSonicMoveResponseDataContainer SonicMoveResponseDataContainer;
+
+	/** Times of the corrections received in the last minute, oldest first. */
+	TArray<double> CorrectionTimes;
+
+	int32 TotalCorrections = 0;
+
+	FSonicFloorProbeCache FloorProbe;
+
+	float TimeSinceFloorProbe = 0.0f;
 };